@@ -32,7 +32,14 @@ if %ERRORLEVEL% EQU 0 (
             src\viewer\ui\settings_window.cpp ^
             src\viewer\ui\timeline_view.cpp ^
             src\viewer\data\session_loader.cpp ^
+            src\viewer\data\columnar_store.cpp ^
+            src\viewer\data\session_parser.cpp ^
+            src\viewer\data\structural_scanner.cpp ^
+            src\viewer\data\background_loader.cpp ^
+            src\viewer\data\session_index.cpp ^
+            src\viewer\data\session_stats.cpp ^
             src\viewer\data\filter_manager.cpp ^
+            src\viewer\graphics\icon_atlas.cpp ^
             src\viewer\graphics\icon_manager.cpp ^
             third_party\imgui\imgui.cpp ^
             third_party\imgui\imgui_demo.cpp ^
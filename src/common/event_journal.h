@@ -0,0 +1,439 @@
+#pragma once
+
+#include <windows.h>
+#include <string>
+#include <string_view>
+#include <fstream>
+#include <iterator>
+#include <cstdint>
+#include <cstring>
+#include "session_data.h"
+#include "session_aggregator.h"
+
+namespace bigbrother {
+
+// Append-only binary journal of the active session.
+//
+// Every focus/title change appends one small record, so persisting an event
+// costs O(bytes of the event) regardless of how much history is stored.
+// Every SNAPSHOT_EVENT_INTERVAL events a snapshot of the aggregates is
+// appended, so replay only has to apply the records after the last snapshot.
+// When the session stops (or on the next start, if the process died
+// mid-session) it is written to its day's history segment
+// (history\YYYY-MM-DD.json, see SegmentStore) and the journal is deleted.
+// The recorder keeps the journal open for writing with read sharing only, so
+// readers can follow it but a second recorder cannot take it over.
+//
+// File layout: "BBJ1" magic, u32 version, then records of
+//   u32 length | u8 type | payload (length - 1 bytes) | u32 FNV-1a(type + payload)
+// A torn or corrupt tail record ends replay; everything before it is kept.
+
+enum class JournalRecordType : uint8_t {
+    SessionStart = 1,  // i64 start, str comment
+    Focus = 2,         // i64 ts, str process_name, str process_path, str window_title
+    Title = 3,         // i64 ts, str window_title
+    Snapshot = 4,      // i64 ts, open interval, aggregates
+    Checkpoint = 5,    // i64 ts: the open interval was still focused at ts
+    Delta = 6,         // Like Snapshot, but only applications/tabs changed since the previous one
+};
+
+static const char JOURNAL_MAGIC[4] = { 'B', 'B', 'J', '1' };
+static const uint32_t JOURNAL_VERSION = 1;
+
+// Journal lives next to the data file: focus_log.json -> focus_log.journal
+inline std::string GetJournalPath(const std::string& dataFilePath) {
+    const std::string ext = ".json";
+    if (dataFilePath.size() >= ext.size() &&
+        dataFilePath.compare(dataFilePath.size() - ext.size(), ext.size(), ext) == 0) {
+        return dataFilePath.substr(0, dataFilePath.size() - ext.size()) + ".journal";
+    }
+    return dataFilePath + ".journal";
+}
+
+inline uint32_t JournalChecksum(const char* data, size_t length) {
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Writer side. Records are staged in memory and written by Commit().
+ */
+class EventJournal {
+public:
+    ~EventJournal() {
+        Close();
+    }
+
+    // Take the journal file (created if missing) without changing it. Fails
+    // if another recorder holds it.
+    bool Open(const std::string& path) {
+        Close();
+        m_file = CreateFileA(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, NULL,
+                             OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, NULL);
+        return m_file != INVALID_HANDLE_VALUE;
+    }
+
+    // Everything in the file, e.g. what a run that never stopped cleanly left
+    bool ReadContents(std::string& data) {
+        data.clear();
+        LARGE_INTEGER size = {};
+        if (!IsOpen() || !GetFileSizeEx(m_file, &size) || !SetFilePointerEx(m_file, LARGE_INTEGER(), NULL, FILE_BEGIN)) {
+            return false;
+        }
+        data.resize((size_t)size.QuadPart);
+        DWORD read = 0;
+        return data.empty() || (ReadFile(m_file, &data[0], (DWORD)data.size(), &read, NULL) && read == data.size());
+    }
+
+    // Drop the contents and write the file header
+    bool Truncate() {
+        if (!IsOpen() || !SetFilePointerEx(m_file, LARGE_INTEGER(), NULL, FILE_BEGIN) || !SetEndOfFile(m_file)) {
+            return false;
+        }
+        m_buffer.clear();
+        m_buffer.append(JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+        PutU32(JOURNAL_VERSION);
+        return Commit();
+    }
+
+    void Close() {
+        if (IsOpen()) {
+            Commit();
+            CloseHandle(m_file);
+            m_file = INVALID_HANDLE_VALUE;
+        }
+        m_buffer.clear();
+    }
+
+    bool IsOpen() const {
+        return m_file != INVALID_HANDLE_VALUE;
+    }
+
+    void AppendSessionStart(long long startTimestamp, const std::string& comment) {
+        BeginRecord(JournalRecordType::SessionStart);
+        PutI64(startTimestamp);
+        PutString(comment);
+        EndRecord();
+    }
+
+    void AppendFocus(long long timestamp, std::string_view processName,
+                     std::string_view processPath, std::string_view windowTitle) {
+        BeginRecord(JournalRecordType::Focus);
+        PutI64(timestamp);
+        PutString(processName);
+        PutString(processPath);
+        PutString(windowTitle);
+        EndRecord();
+    }
+
+    void AppendTitle(long long timestamp, std::string_view windowTitle) {
+        BeginRecord(JournalRecordType::Title);
+        PutI64(timestamp);
+        PutString(windowTitle);
+        EndRecord();
+    }
+
+    void AppendCheckpoint(long long timestamp) {
+        BeginRecord(JournalRecordType::Checkpoint);
+        PutI64(timestamp);
+        EndRecord();
+    }
+
+    // Snapshot of the aggregates after they were finalized up to `timestamp`
+    void AppendSnapshot(long long timestamp, const SessionAggregator& aggregator) {
+        BeginRecord(JournalRecordType::Snapshot);
+        PutOpenInterval(timestamp, aggregator);
+
+        const auto& applications = aggregator.GetApplications();
+        PutU32((uint32_t)applications.size());
+        for (uint32_t appIndex = 0; appIndex < applications.size(); appIndex++) {
+            PutApplication(aggregator, appIndex, applications[appIndex].tabs);
+        }
+        EndRecord();
+    }
+
+    // Only what changed since the aggregator's dirty set was last cleared:
+    // the cost follows the number of touched applications/tabs, not the
+    // size of the session
+    void AppendDelta(long long timestamp, const SessionAggregator& aggregator) {
+        BeginRecord(JournalRecordType::Delta);
+        PutOpenInterval(timestamp, aggregator);
+
+        const auto& dirty = aggregator.GetDirtyApplications();
+        PutU32((uint32_t)dirty.size());
+        for (uint32_t appIndex : dirty) {
+            PutApplication(aggregator, appIndex, aggregator.GetApplications()[appIndex].dirtyTabs);
+        }
+        EndRecord();
+    }
+
+    bool HasPendingRecords() const {
+        return !m_buffer.empty();
+    }
+
+    // Write staged records to disk
+    bool Commit() {
+        if (!IsOpen()) return false;
+        if (m_buffer.empty()) return true;
+
+        DWORD written = 0;
+        bool ok = WriteFile(m_file, m_buffer.data(), (DWORD)m_buffer.size(), &written, NULL) &&
+                  written == m_buffer.size();
+        m_buffer.clear();
+        return ok;
+    }
+
+private:
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    std::string m_buffer;
+    size_t m_recordStart = 0;
+
+    void BeginRecord(JournalRecordType type) {
+        m_recordStart = m_buffer.size();
+        PutU32(0);  // Length placeholder, patched in EndRecord
+        m_buffer.push_back((char)type);
+    }
+
+    void EndRecord() {
+        size_t bodyStart = m_recordStart + sizeof(uint32_t);
+        uint32_t length = (uint32_t)(m_buffer.size() - bodyStart);
+        std::memcpy(&m_buffer[m_recordStart], &length, sizeof(length));
+        PutU32(JournalChecksum(m_buffer.data() + bodyStart, length));
+    }
+
+    void PutOpenInterval(long long timestamp, const SessionAggregator& aggregator) {
+        PutI64(timestamp);
+        PutString(aggregator.GetCurrentProcessName());
+        PutString(aggregator.GetCurrentProcessPath());
+        PutString(aggregator.GetCurrentWindowTitle());
+        PutI64(aggregator.GetCurrentFocusStartTime());
+    }
+
+    void PutApplication(const SessionAggregator& aggregator, uint32_t appIndex, const std::vector<uint32_t>& titleIds) {
+        const auto& appData = aggregator.GetApplications()[appIndex];
+        PutString(aggregator.GetString(appData.nameId));
+        PutString(aggregator.GetString(appData.pathId));
+        PutI64(appData.first_focus_time);
+        PutI64(appData.last_focus_time);
+        PutI64(appData.total_time_ms);
+        PutU32((uint32_t)titleIds.size());
+        for (uint32_t titleId : titleIds) {
+            PutString(aggregator.GetString(titleId));
+            PutI64(aggregator.GetTabTime(appIndex, titleId));
+        }
+    }
+
+    void PutU32(uint32_t value) {
+        m_buffer.append((const char*)&value, sizeof(value));
+    }
+
+    void PutI64(long long value) {
+        int64_t v = value;
+        m_buffer.append((const char*)&v, sizeof(v));
+    }
+
+    void PutString(std::string_view value) {
+        PutU32((uint32_t)value.size());
+        m_buffer.append(value.data(), value.size());
+    }
+};
+
+/**
+ * Reader side: reconstructs the active session from a journal file.
+ */
+class JournalReader {
+public:
+    // Replay the journal into `session`. Returns false if there is no usable session.
+    static bool ReplayFile(const std::string& path, Session& session) {
+        std::ifstream inFile(path, std::ios::binary);
+        if (!inFile.is_open()) {
+            return false;
+        }
+        std::string data((std::istreambuf_iterator<char>(inFile)), std::istreambuf_iterator<char>());
+        inFile.close();
+        return Replay(data, session);
+    }
+
+    // Replay an in-memory copy of a journal file
+    static bool Replay(const std::string& data, Session& session) {
+        if (data.size() < sizeof(JOURNAL_MAGIC) + sizeof(uint32_t) ||
+            std::memcmp(data.data(), JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0) {
+            return false;
+        }
+        size_t begin = sizeof(JOURNAL_MAGIC) + sizeof(uint32_t);
+
+        // Pass 1: validate framing and find the session start, the last
+        // snapshot and the last delta after it
+        size_t sessionStart = 0, lastSnapshot = 0, lastDelta = 0, end = begin;
+        for (size_t pos = begin; ; ) {
+            size_t next = 0;
+            JournalRecordType type;
+            if (!NextRecord(data, pos, type, next)) break;
+            if (type == JournalRecordType::SessionStart) sessionStart = pos;
+            if (type == JournalRecordType::Snapshot) lastSnapshot = pos;
+            if (type == JournalRecordType::Delta) lastDelta = pos;
+            pos = end = next;
+        }
+        if (sessionStart == 0) {
+            return false;
+        }
+
+        // Pass 2: apply the session header, the last snapshot, the deltas after
+        // it and the events after the last delta. Events between the snapshot
+        // and the last delta are already folded into the deltas.
+        SessionAggregator aggregator;
+        long long startTimestamp = 0, lastTimestamp = 0;
+        std::string comment;
+
+        Cursor header(data, sessionStart);
+        startTimestamp = header.GetI64();
+        comment = std::string(header.GetString());
+        lastTimestamp = startTimestamp;
+
+        size_t pos = lastSnapshot > sessionStart ? lastSnapshot : sessionStart;
+        while (pos < end) {
+            size_t next = 0;
+            JournalRecordType type;
+            NextRecord(data, pos, type, next);
+            Cursor c(data, pos);
+            if (pos < lastDelta && type != JournalRecordType::Delta && type != JournalRecordType::Snapshot) {
+                pos = next;
+                continue;
+            }
+
+            switch (type) {
+            case JournalRecordType::Focus: {
+                long long ts = c.GetI64();
+                std::string_view processName = c.GetString();
+                std::string_view processPath = c.GetString();
+                std::string_view windowTitle = c.GetString();
+                aggregator.FinalizeCurrentFocus(ts);
+                aggregator.BeginFocus(processName, processPath, windowTitle, ts);
+                lastTimestamp = ts;
+                break;
+            }
+            case JournalRecordType::Title: {
+                long long ts = c.GetI64();
+                std::string_view windowTitle = c.GetString();
+                if (aggregator.HasCurrentFocus()) {
+                    aggregator.FinalizeCurrentFocus(ts);
+                    aggregator.BeginTitle(windowTitle, ts);
+                }
+                lastTimestamp = ts;
+                break;
+            }
+            case JournalRecordType::Snapshot:
+                lastTimestamp = ReadSnapshot(c, aggregator, true);
+                break;
+            case JournalRecordType::Delta:
+                lastTimestamp = ReadSnapshot(c, aggregator, false);
+                break;
+            case JournalRecordType::Checkpoint:
+                lastTimestamp = c.GetI64();
+                aggregator.FinalizeCurrentFocus(lastTimestamp);
+                break;
+            default:
+                break;
+            }
+            pos = next;
+        }
+
+        // Credit the open interval up to the last thing we know happened
+        aggregator.FinalizeCurrentFocus(lastTimestamp);
+        session = aggregator.BuildSession(startTimestamp, lastTimestamp, comment);
+        return true;
+    }
+
+private:
+    struct Cursor {
+        const std::string& data;
+        size_t pos;
+
+        // Positioned at the payload of the record starting at `recordPos`
+        Cursor(const std::string& d, size_t recordPos)
+            : data(d), pos(recordPos + sizeof(uint32_t) + 1) {}
+
+        uint32_t GetU32() {
+            uint32_t v = 0;
+            if (pos + sizeof(v) <= data.size()) std::memcpy(&v, data.data() + pos, sizeof(v));
+            pos += sizeof(v);
+            return v;
+        }
+
+        long long GetI64() {
+            int64_t v = 0;
+            if (pos + sizeof(v) <= data.size()) std::memcpy(&v, data.data() + pos, sizeof(v));
+            pos += sizeof(v);
+            return v;
+        }
+
+        // View into `data`; valid as long as the journal buffer is
+        std::string_view GetString() {
+            uint32_t length = GetU32();
+            if (pos + length > data.size()) {
+                pos = data.size();
+                return std::string_view();
+            }
+            std::string_view s(data.data() + pos, length);
+            pos += length;
+            return s;
+        }
+    };
+
+    // Validate the record at `pos`; on success report its type and the next offset
+    static bool NextRecord(const std::string& data, size_t pos, JournalRecordType& type, size_t& next) {
+        uint32_t length = 0;
+        if (pos + sizeof(length) > data.size()) return false;
+        std::memcpy(&length, data.data() + pos, sizeof(length));
+        if (length == 0) return false;
+
+        size_t body = pos + sizeof(length);
+        if (body + length + sizeof(uint32_t) > data.size()) return false;  // Torn write
+
+        uint32_t checksum = 0;
+        std::memcpy(&checksum, data.data() + body + length, sizeof(checksum));
+        if (checksum != JournalChecksum(data.data() + body, length)) return false;
+
+        type = (JournalRecordType)data[body];
+        next = body + length + sizeof(uint32_t);
+        return true;
+    }
+
+    // Full snapshots replace the aggregates; deltas overwrite just the entries they carry
+    static long long ReadSnapshot(Cursor& c, SessionAggregator& aggregator, bool full) {
+        if (full) {
+            aggregator.Reset();
+        }
+        long long ts = c.GetI64();
+        std::string_view processName = c.GetString();
+        std::string_view processPath = c.GetString();
+        std::string_view windowTitle = c.GetString();
+        long long focusStart = c.GetI64();
+
+        uint32_t appCount = c.GetU32();
+        for (uint32_t i = 0; i < appCount; i++) {
+            std::string_view name = c.GetString();
+            std::string_view path = c.GetString();
+            long long firstFocus = c.GetI64();
+            long long lastFocus = c.GetI64();
+            long long totalTime = c.GetI64();
+            uint32_t appIndex = aggregator.RestoreApplication(name, path, firstFocus, lastFocus, totalTime);
+
+            uint32_t tabCount = c.GetU32();
+            for (uint32_t t = 0; t < tabCount; t++) {
+                std::string_view title = c.GetString();
+                aggregator.RestoreTab(appIndex, title, c.GetI64());
+            }
+        }
+
+        // An empty name clears the open interval
+        aggregator.BeginFocus(processName, processPath, windowTitle, focusStart);
+        return ts;
+    }
+};
+
+} // namespace bigbrother
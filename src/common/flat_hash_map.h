@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace bigbrother {
+
+inline uint64_t MixHash64(uint64_t x) {
+    // splitmix64 finalizer: spreads packed integer IDs across the table
+    x ^= x >> 30; x *= 0xbf58476d1ce4e5b9ull;
+    x ^= x >> 27; x *= 0x94d049bb133111ebull;
+    x ^= x >> 31;
+    return x;
+}
+
+// Open-addressing hash map from 64-bit integer keys to small POD values.
+//
+// Slots live in one contiguous array with linear probing, so a lookup is a
+// hash plus a short scan with no pointer chasing, and inserting a key that is
+// already present never allocates. EMPTY_KEY is reserved. No erase: the
+// tables it backs only grow until they are cleared.
+template <typename V>
+class FlatHashMap {
+public:
+    static constexpr uint64_t EMPTY_KEY = 0xFFFFFFFFFFFFFFFFull;
+
+    V* Find(uint64_t key) {
+        size_t slot = Probe(key);
+        return m_slots[slot].key == key ? &m_slots[slot].value : nullptr;
+    }
+
+    const V* Find(uint64_t key) const {
+        size_t slot = Probe(key);
+        return m_slots[slot].key == key ? &m_slots[slot].value : nullptr;
+    }
+
+    // Value for `key`, value-initialized on first use
+    V& operator[](uint64_t key) {
+        size_t slot = Probe(key);
+        if (m_slots[slot].key == key) {
+            return m_slots[slot].value;
+        }
+        if ((m_size + 1) * 2 > m_slots.size()) {
+            Grow();
+            slot = Probe(key);
+        }
+        m_slots[slot].key = key;
+        m_slots[slot].value = V();
+        m_size++;
+        return m_slots[slot].value;
+    }
+
+    size_t Size() const {
+        return m_size;
+    }
+
+    // Calls fn(key, value) for every entry, in table order
+    template <typename Fn>
+    void ForEach(Fn fn) const {
+        for (const Slot& s : m_slots) {
+            if (s.key != EMPTY_KEY) {
+                fn(s.key, s.value);
+            }
+        }
+    }
+
+    void Clear() {
+        m_slots.assign(INITIAL_SIZE, Slot());
+        m_size = 0;
+    }
+
+private:
+    struct Slot {
+        uint64_t key = EMPTY_KEY;
+        V value = V();
+    };
+
+    static constexpr size_t INITIAL_SIZE = 64;
+
+    std::vector<Slot> m_slots = std::vector<Slot>(INITIAL_SIZE);
+    size_t m_size = 0;
+
+    size_t Probe(uint64_t key) const {
+        size_t mask = m_slots.size() - 1;
+        size_t slot = (size_t)MixHash64(key) & mask;
+        while (m_slots[slot].key != key && m_slots[slot].key != EMPTY_KEY) {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+    void Grow() {
+        std::vector<Slot> old(m_slots.size() * 2);
+        old.swap(m_slots);
+        for (const Slot& s : old) {
+            if (s.key != EMPTY_KEY) {
+                m_slots[Probe(s.key)] = s;
+            }
+        }
+    }
+};
+
+} // namespace bigbrother
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <chrono>
+
+namespace bigbrother {
+
+// Decides when the journal writer commits and checkpoints.
+//
+// Group commit: the first uncommitted record opens a window of at most
+// `durabilityDeadline`; everything that arrives inside the window goes out in
+// the same write, so an alt-tab storm costs one write and no more than the
+// deadline's worth of events is ever at risk.
+//
+// Checkpoints: an open focus interval only becomes durable when the next event
+// closes it, so after `checkpointInterval` without any record the writer is
+// asked to checkpoint the open interval on its own.
+class FlushScheduler {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    static constexpr std::chrono::milliseconds DEFAULT_DURABILITY_DEADLINE{ 1000 };
+    static constexpr std::chrono::milliseconds DEFAULT_CHECKPOINT_INTERVAL{ 30000 };
+
+    void SetDurabilityDeadline(std::chrono::milliseconds deadline) { m_durabilityDeadline = deadline; }
+    void SetCheckpointInterval(std::chrono::milliseconds interval) { m_checkpointInterval = interval; }
+    std::chrono::milliseconds GetDurabilityDeadline() const { return m_durabilityDeadline; }
+    std::chrono::milliseconds GetCheckpointInterval() const { return m_checkpointInterval; }
+
+    void Reset(Clock::time_point now) {
+        m_pending = false;
+        m_oldestPending = now;
+        m_lastRecord = now;
+    }
+
+    // A record was staged in the journal buffer
+    void OnAppend(Clock::time_point now) {
+        if (!m_pending) {
+            m_pending = true;
+            m_oldestPending = now;
+        }
+        m_lastRecord = now;
+    }
+
+    // Staged records reached the disk
+    void OnCommit() {
+        m_pending = false;
+    }
+
+    bool HasPending() const { return m_pending; }
+
+    bool CommitDue(Clock::time_point now) const {
+        return m_pending && now - m_oldestPending >= m_durabilityDeadline;
+    }
+
+    bool CheckpointDue(Clock::time_point now) const {
+        return now - m_lastRecord >= m_checkpointInterval;
+    }
+
+    // How long the writer may sleep before the next commit or checkpoint is due
+    std::chrono::milliseconds TimeUntilNextDeadline(Clock::time_point now, bool intervalOpen) const {
+        auto wait = std::chrono::milliseconds::max();
+        if (m_pending) {
+            wait = Remaining(m_oldestPending + m_durabilityDeadline, now);
+        }
+        if (intervalOpen) {
+            auto checkpoint = Remaining(m_lastRecord + m_checkpointInterval, now);
+            if (checkpoint < wait) wait = checkpoint;
+        }
+        return wait;
+    }
+
+private:
+    std::chrono::milliseconds m_durabilityDeadline = DEFAULT_DURABILITY_DEADLINE;
+    std::chrono::milliseconds m_checkpointInterval = DEFAULT_CHECKPOINT_INTERVAL;
+    bool m_pending = false;
+    Clock::time_point m_oldestPending;
+    Clock::time_point m_lastRecord;
+
+    static std::chrono::milliseconds Remaining(Clock::time_point due, Clock::time_point now) {
+        if (due <= now) return std::chrono::milliseconds(0);
+        // Round up so the writer never wakes just before the deadline
+        return std::chrono::ceil<std::chrono::milliseconds>(due - now);
+    }
+};
+
+} // namespace bigbrother
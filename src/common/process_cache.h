@@ -0,0 +1,181 @@
+#pragma once
+
+#include <windows.h>
+#include <unordered_map>
+#include "process_identity.h"
+
+namespace bigbrother {
+
+// Cache of resolved process identities, keyed by PID.
+//
+// Each entry keeps a handle to its process open. Windows never recycles a
+// PID while a handle to the process object exists, so as long as we hold the
+// handle, any window reporting that PID belongs to the process we cached and
+// a hit needs no kernel call at all. Entries whose process has exited are
+// invalidated (and their handle released) when the cache needs room, which
+// is when a reused PID could first appear.
+//
+// Lookups go through a tiny MRU array first: foreground switches bounce
+// between a handful of processes, so most hits never touch the hash map.
+// Hook thread only; not thread-safe.
+class ProcessIdentityCache {
+public:
+    struct Stats {
+        unsigned long long hits = 0;
+        unsigned long long misses = 0;
+        unsigned long long invalidations = 0;  // Entries dropped because their process exited
+    };
+
+    ProcessIdentityCache() = default;
+    ProcessIdentityCache(const ProcessIdentityCache&) = delete;
+    ProcessIdentityCache& operator=(const ProcessIdentityCache&) = delete;
+
+    ~ProcessIdentityCache() {
+        Clear();
+    }
+
+    // Copy the identity of `processId` into `identity`, resolving it on a miss.
+    // Returns true on a cache hit.
+    bool Lookup(DWORD processId, ProcessIdentity& identity) {
+        if (processId == 0) {
+            SetUnresolvedIdentity(processId, "Unknown Process", identity);
+            return true;
+        }
+
+        Entry* entry = FindEntry(processId);
+        if (entry) {
+            m_stats.hits++;
+            identity = entry->identity;
+            return true;
+        }
+
+        m_stats.misses++;
+        entry = Insert(processId);
+        if (entry) {
+            identity = entry->identity;
+        } else {
+            // Could not hold a handle, so the result cannot be validated later
+            ResolveProcessIdentity(processId, identity);
+        }
+        return false;
+    }
+
+    void Clear() {
+        for (auto& [processId, entry] : m_entries) {
+            CloseHandle(entry.hProcess);
+        }
+        m_entries.clear();
+        for (auto& slot : m_mru) slot = nullptr;
+    }
+
+    const Stats& GetStats() const {
+        return m_stats;
+    }
+
+private:
+    struct Entry {
+        ProcessIdentity identity;
+        HANDLE hProcess = NULL;              // Pins the PID to this process
+        unsigned long long lastUse = 0;
+    };
+
+    static const size_t MRU_SIZE = 4;
+    static const size_t MAX_ENTRIES = 64;
+
+    std::unordered_map<DWORD, Entry> m_entries;  // Node-based: Entry pointers stay valid
+    Entry* m_mru[MRU_SIZE] = {};
+    unsigned long long m_useClock = 0;
+    Stats m_stats;
+
+    Entry* FindEntry(DWORD processId) {
+        for (size_t i = 0; i < MRU_SIZE && m_mru[i]; i++) {
+            if (m_mru[i]->identity.processId == processId) {
+                Entry* entry = m_mru[i];
+                Touch(entry, i);
+                return entry;
+            }
+        }
+
+        auto it = m_entries.find(processId);
+        if (it == m_entries.end()) {
+            return nullptr;
+        }
+        Touch(&it->second, MRU_SIZE - 1);
+        return &it->second;
+    }
+
+    // Move `entry` to the front of the MRU array, shifting slots [0, from) down
+    void Touch(Entry* entry, size_t from) {
+        entry->lastUse = ++m_useClock;
+        if (m_mru[0] == entry) return;
+        for (size_t i = from; i > 0; i--) {
+            m_mru[i] = m_mru[i - 1];
+        }
+        m_mru[0] = entry;
+    }
+
+    Entry* Insert(DWORD processId) {
+        Entry entry;
+
+        // Full rights resolve the image path; fall back to a limited handle
+        // that can still pin the PID for processes we may not inspect
+        entry.hProcess = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ | SYNCHRONIZE, FALSE, processId);
+        if (entry.hProcess) {
+            if (!QueryProcessImage(entry.hProcess, processId, entry.identity)) {
+                SetUnresolvedIdentity(processId, "Unknown Process", entry.identity);
+            }
+        } else {
+            SetUnresolvedIdentity(processId, "Access Denied", entry.identity);
+            entry.hProcess = OpenProcess(PROCESS_QUERY_LIMITED_INFORMATION | SYNCHRONIZE, FALSE, processId);
+            if (!entry.hProcess) {
+                return nullptr;
+            }
+        }
+
+        if (m_entries.size() >= MAX_ENTRIES) {
+            MakeRoom();
+        }
+
+        Entry& stored = m_entries[processId] = entry;
+        Touch(&stored, MRU_SIZE - 1);
+        return &stored;
+    }
+
+    // Drop every entry whose process has exited; if none did, evict the LRU one
+    void MakeRoom() {
+        Entry* oldest = nullptr;
+        DWORD oldestId = 0;
+
+        for (auto it = m_entries.begin(); it != m_entries.end(); ) {
+            if (WaitForSingleObject(it->second.hProcess, 0) == WAIT_OBJECT_0) {
+                m_stats.invalidations++;
+                it = Erase(it);
+                continue;
+            }
+            if (!oldest || it->second.lastUse < oldest->lastUse) {
+                oldest = &it->second;
+                oldestId = it->first;
+            }
+            ++it;
+        }
+
+        if (m_entries.size() >= MAX_ENTRIES && oldest) {
+            Erase(m_entries.find(oldestId));
+        }
+    }
+
+    std::unordered_map<DWORD, Entry>::iterator Erase(std::unordered_map<DWORD, Entry>::iterator it) {
+        Entry* entry = &it->second;
+        for (size_t i = 0; i < MRU_SIZE; i++) {
+            if (m_mru[i] == entry) {
+                for (size_t j = i; j + 1 < MRU_SIZE; j++) m_mru[j] = m_mru[j + 1];
+                m_mru[MRU_SIZE - 1] = nullptr;
+                break;
+            }
+        }
+        CloseHandle(entry->hProcess);
+        return m_entries.erase(it);
+    }
+};
+
+} // namespace bigbrother
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <windows.h>
+#include <psapi.h>
+#include <cstdio>
+#include <cstring>
+
+namespace bigbrother {
+
+// Identity of the process that owns a window. Fixed-size so it can be filled
+// on the hook thread and copied into the event queue without allocating.
+struct ProcessIdentity {
+    DWORD processId = 0;
+    char processName[MAX_PATH] = "";
+    char processPath[MAX_PATH] = "";
+};
+
+// Labels the log has always used for processes we cannot resolve:
+// "Access Denied" / "Unknown Process" with "PID: n" as the path.
+inline void SetUnresolvedIdentity(DWORD processId, const char* label, ProcessIdentity& identity) {
+    identity.processId = processId;
+    std::snprintf(identity.processName, sizeof(identity.processName), "%s", label);
+    if (processId == 0) {
+        std::snprintf(identity.processPath, sizeof(identity.processPath), "Unknown");
+    } else {
+        std::snprintf(identity.processPath, sizeof(identity.processPath), "PID: %lu", (unsigned long)processId);
+    }
+}
+
+// Fill name and path from an open process handle (needs QUERY_INFORMATION | VM_READ)
+inline bool QueryProcessImage(HANDLE hProcess, DWORD processId, ProcessIdentity& identity) {
+    DWORD pathLength = GetModuleFileNameExA(hProcess, NULL, identity.processPath, MAX_PATH);
+    if (pathLength == 0) {
+        return false;
+    }
+    identity.processId = processId;
+
+    const char* lastSlash = std::strrchr(identity.processPath, '\\');
+    const char* lastForward = std::strrchr(identity.processPath, '/');
+    if (lastForward && (!lastSlash || lastForward > lastSlash)) lastSlash = lastForward;
+    const char* name = lastSlash ? lastSlash + 1 : identity.processPath;
+    std::snprintf(identity.processName, sizeof(identity.processName), "%s", name);
+    return true;
+}
+
+// Resolve the executable behind `processId` without caching
+inline void ResolveProcessIdentity(DWORD processId, ProcessIdentity& identity) {
+    if (processId == 0) {
+        SetUnresolvedIdentity(processId, "Unknown Process", identity);
+        return;
+    }
+
+    HANDLE hProcess = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, processId);
+    if (hProcess == NULL) {
+        SetUnresolvedIdentity(processId, "Access Denied", identity);
+        return;
+    }
+
+    bool resolved = QueryProcessImage(hProcess, processId, identity);
+    CloseHandle(hProcess);
+
+    if (!resolved) {
+        SetUnresolvedIdentity(processId, "Unknown Process", identity);
+    }
+}
+
+} // namespace bigbrother
@@ -0,0 +1,405 @@
+#pragma once
+
+#include <windows.h>
+#include <string>
+#include <string_view>
+#include <iterator>
+#include <vector>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+#include <cstdio>
+#include "json.hpp"
+#include "session_data.h"
+#include "session_writer.h"
+#include "time_utils.h"
+
+namespace bigbrother {
+
+// One per-day history file, as listed in the manifest
+struct SegmentInfo {
+    std::string file;               // "2025-09-30.json", relative to the history directory
+    long long start_timestamp = 0;  // Earliest session start in the segment (0 if unknown)
+    long long end_timestamp = 0;    // Latest session end in the segment (0 if unknown)
+    size_t session_count = 0;
+};
+
+// Per-day segmented session history.
+//
+// Finished sessions live in <data dir>\history\YYYY-MM-DD.json, keyed by the
+// local date the session started. Each segment is an ordinary
+// {"sessions": [...]} document. manifest.json lists the segments and their
+// time ranges, so readers can pick the days they need without opening the
+// rest. Writing a session rewrites only its own day plus the manifest, so the
+// cost no longer grows with the amount of history. Files are replaced
+// atomically (temp file + rename), which means a concurrent reader never
+// sees a half-written file.
+//
+// A focus_log.json from before segmentation is left as it is. Readers treat
+// it as the oldest part of history.
+class SegmentStore {
+public:
+    static constexpr const char* HISTORY_DIRECTORY = "history";
+    static constexpr const char* MANIFEST_FILE = "manifest.json";
+
+    explicit SegmentStore(const std::string& dataFilePath = "") {
+        SetDataFilePath(dataFilePath);
+    }
+
+    // focus_log.json path; the history directory sits next to it
+    void SetDataFilePath(const std::string& dataFilePath) {
+        size_t lastSlash = dataFilePath.find_last_of("\\/");
+        std::string dataDir = lastSlash == std::string::npos ? "." : dataFilePath.substr(0, lastSlash);
+        m_historyDir = dataDir + "\\" + HISTORY_DIRECTORY;
+    }
+
+    const std::string& GetHistoryDirectory() const { return m_historyDir; }
+    std::string GetSegmentPath(const std::string& file) const { return m_historyDir + "\\" + file; }
+    std::string GetManifestPath() const { return GetSegmentPath(MANIFEST_FILE); }
+
+    static std::string GetSegmentFileName(long long startTimestamp) {
+        return FormatDate(startTimestamp) + ".json";
+    }
+
+    // Segments oldest first. Falls back to listing the directory (without time
+    // ranges) when the manifest is missing or unreadable.
+    std::vector<SegmentInfo> ListSegments() const {
+        std::vector<SegmentInfo> segments;
+        if (!ReadManifest(segments)) {
+            segments = ScanDirectory();
+        }
+        return segments;
+    }
+
+    // Store a finished session in its day's segment, replacing an earlier copy
+    bool WriteSession(const Session& session, JsonStyle style = JsonStyle::Compact) {
+        CreateDirectoryA(m_historyDir.c_str(), NULL);
+
+        SegmentInfo summary;
+        summary.file = GetSegmentFileName(session.start_timestamp);
+        bool found = false;
+        if (!RewriteSessionFile(GetSegmentPath(summary.file), session.start_timestamp, &session, style, summary, found)) {
+            return false;
+        }
+        return UpdateManifest(summary);
+    }
+
+    // True if the session starting at `startTimestamp` is stored and ends no
+    // earlier than `endTimestamp`
+    bool HasSession(long long startTimestamp, long long endTimestamp) const {
+        std::string contents;
+        std::vector<StoredSession> existing;
+        if (!ReadStoredSessions(GetSegmentPath(GetSegmentFileName(startTimestamp)), contents, existing)) {
+            return false;
+        }
+        for (const auto& stored : existing) {
+            if (stored.isSession && stored.start_timestamp == startTimestamp) {
+                return stored.end_timestamp >= endTimestamp;
+            }
+        }
+        return false;
+    }
+
+    // Remove a session from its day's segment. False if no segment holds it.
+    bool DeleteSession(long long startTimestamp, JsonStyle style = JsonStyle::Compact) {
+        SegmentInfo summary;
+        summary.file = GetSegmentFileName(startTimestamp);
+        bool found = false;
+        if (!RewriteSessionFile(GetSegmentPath(summary.file), startTimestamp, nullptr, style, summary, found) || !found) {
+            return false;
+        }
+        if (summary.session_count == 0) {
+            DeleteFileA(GetSegmentPath(summary.file).c_str());
+        }
+        return UpdateManifest(summary);
+    }
+
+    // Replace the session starting at `startTimestamp` in a {"sessions": [...]}
+    // file with `replacement` (appended if absent), or remove it when
+    // `replacement` is null. The other sessions are copied through byte for
+    // byte, so rewriting a day never changes the sessions already in it.
+    // `summary` receives the file's resulting range and count. Removing a
+    // session that is not there leaves the file untouched.
+    static bool RewriteSessionFile(const std::string& path, long long startTimestamp, const Session* replacement,
+                                   JsonStyle style, SegmentInfo& summary, bool& found) {
+        std::string contents;
+        std::vector<StoredSession> existing;
+        if (!ReadStoredSessions(path, contents, existing)) {
+            return false;  // Never overwrite a file we could not read
+        }
+
+        found = false;
+        for (const auto& stored : existing) {
+            if (stored.isSession && stored.start_timestamp == startTimestamp) {
+                found = true;
+                break;
+            }
+        }
+        if (!replacement && !found) {
+            return true;
+        }
+
+        std::string tempPath = path + ".tmp";
+        {
+            std::ofstream outFile(tempPath, std::ios::binary);
+            if (!outFile.is_open()) {
+                return false;
+            }
+
+            JsonStreamWriter writer(style, &outFile);
+            summary.session_count = 0;
+            summary.start_timestamp = summary.end_timestamp = 0;
+
+            writer.BeginObject();
+            writer.Key("sessions");
+            writer.BeginArray();
+            for (const auto& stored : existing) {
+                if (stored.isSession && stored.start_timestamp == startTimestamp) {
+                    if (!replacement) continue;
+                    WriteSessionJson(writer, *replacement);
+                    AddToSummary(summary, replacement->start_timestamp, replacement->end_timestamp);
+                } else {
+                    writer.Raw(std::string_view(contents).substr(stored.begin, stored.end - stored.begin));
+                    if (stored.isSession) {
+                        AddToSummary(summary, stored.start_timestamp, stored.end_timestamp);
+                    }
+                }
+                writer.MaybeFlush();
+            }
+            if (replacement && !found) {
+                WriteSessionJson(writer, *replacement);
+                AddToSummary(summary, replacement->start_timestamp, replacement->end_timestamp);
+            }
+            writer.EndArray();
+            writer.EndObject();
+            writer.Newline();
+            if (!writer.Flush()) {
+                return false;
+            }
+        }
+        return ReplaceFile(tempPath, path);
+    }
+
+private:
+    // One element of a file's "sessions" array, as it is on disk
+    struct StoredSession {
+        size_t begin = 0;               // Byte range in the file
+        size_t end = 0;
+        long long start_timestamp = 0;
+        long long end_timestamp = 0;
+        bool isSession = false;         // False for elements that are not objects (copied, not counted)
+    };
+
+    std::string m_historyDir;
+
+    static void AddToSummary(SegmentInfo& summary, long long start, long long end) {
+        if (summary.session_count == 0 || start < summary.start_timestamp) summary.start_timestamp = start;
+        if (end > summary.end_timestamp) summary.end_timestamp = end;
+        summary.session_count++;
+    }
+
+    // The elements of a file's "sessions" array (none if the file does not
+    // exist yet), located in `contents` without building a json tree.
+    // False if the file exists but is not valid JSON.
+    static bool ReadStoredSessions(const std::string& path, std::string& contents, std::vector<StoredSession>& sessions) {
+        sessions.clear();
+        std::ifstream inFile(path, std::ios::binary);
+        if (!inFile.is_open()) {
+            return true;
+        }
+        contents.assign(std::istreambuf_iterator<char>(inFile), std::istreambuf_iterator<char>());
+        if (!nlohmann::json::accept(contents)) {
+            std::cerr << "[ERROR] Could not parse " << path << std::endl;
+            return false;
+        }
+
+        FindSessionRanges(contents, sessions);
+        for (auto& stored : sessions) {
+            stored.isSession = ReadSessionTimes(std::string_view(contents).substr(stored.begin, stored.end - stored.begin),
+                                                stored.start_timestamp, stored.end_timestamp);
+        }
+        return true;
+    }
+
+    // Byte ranges of the elements of the root object's "sessions" array.
+    // `contents` must be valid JSON; anything else is ignored.
+    static void FindSessionRanges(const std::string& contents, std::vector<StoredSession>& sessions) {
+        static const char SESSIONS_KEY[] = "\"sessions\"";
+        const size_t NONE = std::string::npos;
+        size_t depth = 0;
+        bool inSessions = false;
+        bool afterSessionsKey = false;
+        bool afterSessionsColon = false;
+        StoredSession element;
+        element.begin = NONE;
+
+        for (size_t i = 0; i < contents.size(); i++) {
+            char c = contents[i];
+            if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+                continue;
+            }
+            bool key = afterSessionsKey;
+            bool colon = afterSessionsColon;
+            afterSessionsKey = afterSessionsColon = false;
+
+            if (inSessions && depth == 2) {
+                if (c == ',' || c == ']') {
+                    if (element.begin != NONE) {
+                        sessions.push_back(element);
+                    }
+                    element.begin = NONE;
+                    if (c == ']') {
+                        return;
+                    }
+                    continue;
+                }
+                if (element.begin == NONE) {
+                    element.begin = i;
+                }
+            }
+
+            if (c == '"') {
+                size_t close = i + 1;
+                while (close < contents.size() && contents[close] != '"') {
+                    close += contents[close] == '\\' ? 2 : 1;
+                }
+                afterSessionsKey = depth == 1 && !inSessions &&
+                                   contents.compare(i, close + 1 - i, SESSIONS_KEY) == 0;
+                i = close;
+            } else if (c == ':') {
+                afterSessionsColon = key;
+            } else if (c == '{' || c == '[') {
+                if (c == '[' && colon) {
+                    inSessions = true;
+                }
+                depth++;
+            } else if (c == '}' || c == ']') {
+                depth--;
+            }
+
+            if (element.begin != NONE) {
+                element.end = i + 1;
+            }
+        }
+    }
+
+    // Timestamps of one serialized session; false if it is not an object.
+    // Only the two top-level fields are kept while it is parsed.
+    static bool ReadSessionTimes(std::string_view sessionJson, long long& start, long long& end) {
+        using json = nlohmann::json;
+        json session = json::parse(sessionJson.begin(), sessionJson.end(),
+            [](int depth, json::parse_event_t event, json& parsed) {
+                return event != json::parse_event_t::key || depth != 1 ||
+                       parsed == "start_timestamp" || parsed == "end_timestamp";
+            }, false);
+        if (!session.is_object()) {
+            return false;
+        }
+
+        // Like the viewer's parser: a field of another type counts as missing
+        auto it = session.find("start_timestamp");
+        start = it != session.end() && it->is_number() ? it->get<long long>() : 0;
+        it = session.find("end_timestamp");
+        end = it != session.end() && it->is_number() ? it->get<long long>() : 0;
+        return true;
+    }
+
+    static bool ReplaceFile(const std::string& tempPath, const std::string& path) {
+        if (!MoveFileExA(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH)) {
+            DeleteFileA(tempPath.c_str());
+            return false;
+        }
+        return true;
+    }
+
+    bool ReadManifest(std::vector<SegmentInfo>& segments) const {
+        std::ifstream inFile(GetManifestPath());
+        if (!inFile.is_open()) {
+            return false;
+        }
+        try {
+            nlohmann::json manifest;
+            inFile >> manifest;
+            if (!manifest.contains("segments") || !manifest["segments"].is_array()) {
+                return false;
+            }
+            for (const auto& entry : manifest["segments"]) {
+                SegmentInfo segment;
+                segment.file = entry.value("file", "");
+                segment.start_timestamp = entry.value("start_timestamp", 0LL);
+                segment.end_timestamp = entry.value("end_timestamp", 0LL);
+                segment.session_count = entry.value("session_count", (size_t)0);
+                if (!segment.file.empty()) {
+                    segments.push_back(segment);
+                }
+            }
+        } catch (const nlohmann::json::exception& e) {
+            return false;
+        }
+        return true;
+    }
+
+    std::vector<SegmentInfo> ScanDirectory() const {
+        std::vector<SegmentInfo> segments;
+        WIN32_FIND_DATAA findData;
+        HANDLE hFind = FindFirstFileA((m_historyDir + "\\*.json").c_str(), &findData);
+        if (hFind == INVALID_HANDLE_VALUE) {
+            return segments;
+        }
+        do {
+            std::string file = findData.cFileName;
+            if (file != MANIFEST_FILE) {
+                SegmentInfo segment;
+                segment.file = file;
+                segments.push_back(segment);
+            }
+        } while (FindNextFileA(hFind, &findData));
+        FindClose(hFind);
+
+        // YYYY-MM-DD names sort chronologically
+        std::sort(segments.begin(), segments.end(), [](const SegmentInfo& a, const SegmentInfo& b) {
+            return a.file < b.file;
+        });
+        return segments;
+    }
+
+    // Record `summary` in the manifest (dropping the entry once the segment is empty)
+    bool UpdateManifest(const SegmentInfo& summary) const {
+        std::vector<SegmentInfo> segments = ListSegments();
+        segments.erase(std::remove_if(segments.begin(), segments.end(),
+            [&](const SegmentInfo& s) { return s.file == summary.file; }), segments.end());
+        if (summary.session_count > 0) {
+            segments.push_back(summary);
+        }
+        std::sort(segments.begin(), segments.end(), [](const SegmentInfo& a, const SegmentInfo& b) {
+            return a.file < b.file;
+        });
+
+        nlohmann::json manifest;
+        manifest["version"] = 1;
+        manifest["segments"] = nlohmann::json::array();
+        for (const auto& segment : segments) {
+            manifest["segments"].push_back({
+                { "file", segment.file },
+                { "start_timestamp", segment.start_timestamp },
+                { "end_timestamp", segment.end_timestamp },
+                { "session_count", segment.session_count }
+            });
+        }
+
+        std::string tempPath = GetManifestPath() + ".tmp";
+        {
+            std::ofstream outFile(tempPath, std::ios::binary);
+            if (!outFile.is_open()) {
+                return false;
+            }
+            outFile << manifest.dump(2) << std::endl;
+            if (!outFile.good()) {
+                return false;
+            }
+        }
+        return ReplaceFile(tempPath, GetManifestPath());
+    }
+};
+
+} // namespace bigbrother
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "session_data.h"
+#include "string_interner.h"
+#include "flat_hash_map.h"
+
+namespace bigbrother {
+
+// Accumulates focus intervals into per-application / per-tab totals.
+// Shared by the live SessionLogger and by journal replay so both produce
+// identical aggregates from the same sequence of events.
+//
+// Process names, paths and window titles are interned once per session and
+// the tables are keyed by their IDs, so an event for an application and
+// title that were already seen performs no heap allocation: finalizing an
+// interval is two open-addressing lookups on integers.
+//
+// Every application and tab touched since the last ClearDirty() is recorded,
+// so the journal can persist just what changed instead of the whole session.
+class SessionAggregator {
+public:
+    struct ApplicationData {
+        uint32_t nameId = StringInterner::INVALID_ID;
+        uint32_t pathId = StringInterner::INVALID_ID;
+        long long first_focus_time = 0;
+        long long last_focus_time = 0;
+        long long total_time_ms = 0;
+        std::vector<uint32_t> tabs;  // Title IDs in first-seen order; times live in the tab table
+        bool dirty = false;
+        std::vector<uint32_t> dirtyTabs;  // Title IDs changed since the last ClearDirty()
+    };
+
+    void Reset() {
+        m_strings.Clear();
+        m_applications.clear();
+        m_applicationIndex.Clear();
+        m_tabs.Clear();
+        m_dirtyApplications.clear();
+        m_currentProcessName = StringInterner::INVALID_ID;
+        m_currentProcessPath = StringInterner::INVALID_ID;
+        m_currentWindowTitle = StringInterner::INVALID_ID;
+        m_currentFocusStartTime = 0;
+    }
+
+    // Start a new focus interval (previous interval must already be finalized)
+    void BeginFocus(std::string_view processName, std::string_view processPath,
+                    std::string_view windowTitle, long long timestamp) {
+        m_currentProcessName = processName.empty() ? StringInterner::INVALID_ID : m_strings.Intern(processName);
+        m_currentProcessPath = m_strings.Intern(processPath);
+        m_currentWindowTitle = m_strings.Intern(windowTitle);
+        m_currentFocusStartTime = std::max(timestamp, m_currentFocusStartTime);
+    }
+
+    // Switch to a new tab within the currently focused application
+    void BeginTitle(std::string_view windowTitle, long long timestamp) {
+        m_currentWindowTitle = m_strings.Intern(windowTitle);
+        m_currentFocusStartTime = std::max(timestamp, m_currentFocusStartTime);
+    }
+
+    // Credit the open interval up to `timestamp` and keep it open from there.
+    // Events are stamped on the hook thread before they are queued, so one
+    // can be a second older than a checkpoint the writer already applied;
+    // the interval then ends where it started and time never runs backwards.
+    bool FinalizeCurrentFocus(long long timestamp) {
+        if (m_currentFocusStartTime == 0 || !HasCurrentFocus()) {
+            return false;  // Nothing to finalize
+        }
+
+        timestamp = std::max(timestamp, m_currentFocusStartTime);
+        long long timeSpentMs = (timestamp - m_currentFocusStartTime) * 1000;  // Convert seconds to milliseconds
+
+        // Get or create application entry
+        uint32_t appIndex = FindOrAddApplication(m_currentProcessName, m_currentProcessPath, m_currentFocusStartTime);
+        ApplicationData& appData = m_applications[appIndex];
+
+        // Update application data
+        appData.last_focus_time = timestamp;
+        appData.total_time_ms += timeSpentMs;
+
+        // Update tab data
+        TabEntry& tab = Tab(appIndex, m_currentWindowTitle);
+        tab.total_time_ms += timeSpentMs;
+        MarkDirty(appIndex, m_currentWindowTitle, tab);
+
+        m_currentFocusStartTime = timestamp;
+        return true;
+    }
+
+    bool HasCurrentFocus() const { return m_currentProcessName != StringInterner::INVALID_ID; }
+    std::string_view GetCurrentProcessName() const { return m_strings.Get(m_currentProcessName); }
+    std::string_view GetCurrentProcessPath() const { return m_strings.Get(m_currentProcessPath); }
+    std::string_view GetCurrentWindowTitle() const { return m_strings.Get(m_currentWindowTitle); }
+    long long GetCurrentFocusStartTime() const { return m_currentFocusStartTime; }
+
+    // Text behind an ID from ApplicationData
+    std::string_view GetString(uint32_t id) const { return m_strings.Get(id); }
+
+    // Applications in first-seen order
+    const std::vector<ApplicationData>& GetApplications() const { return m_applications; }
+
+    long long GetTabTime(uint32_t appIndex, uint32_t titleId) const {
+        const TabEntry* tab = m_tabs.Find(TabKey(appIndex, titleId));
+        return tab ? tab->total_time_ms : 0;
+    }
+
+    // Indices of applications changed since the last ClearDirty(); each lists its changed tabs
+    const std::vector<uint32_t>& GetDirtyApplications() const { return m_dirtyApplications; }
+
+    // Everything so far has been persisted. Keeps the lists' capacity, so
+    // steady-state tracking does not allocate.
+    void ClearDirty() {
+        for (uint32_t appIndex : m_dirtyApplications) {
+            ApplicationData& appData = m_applications[appIndex];
+            for (uint32_t titleId : appData.dirtyTabs) {
+                m_tabs.Find(TabKey(appIndex, titleId))->dirty = false;
+            }
+            appData.dirtyTabs.clear();
+            appData.dirty = false;
+        }
+        m_dirtyApplications.clear();
+    }
+
+    // Re-create an application from a journal snapshot; returns its index for RestoreTab
+    uint32_t RestoreApplication(std::string_view processName, std::string_view processPath,
+                                long long firstFocusTime, long long lastFocusTime, long long totalTimeMs) {
+        uint32_t appIndex = FindOrAddApplication(m_strings.Intern(processName), m_strings.Intern(processPath), firstFocusTime);
+        ApplicationData& appData = m_applications[appIndex];
+        appData.last_focus_time = lastFocusTime;
+        appData.total_time_ms = totalTimeMs;
+        if (!appData.dirty) {
+            appData.dirty = true;
+            m_dirtyApplications.push_back(appIndex);
+        }
+        return appIndex;
+    }
+
+    void RestoreTab(uint32_t appIndex, std::string_view windowTitle, long long totalTimeMs) {
+        uint32_t titleId = m_strings.Intern(windowTitle);
+        TabEntry& tab = Tab(appIndex, titleId);
+        tab.total_time_ms = totalTimeMs;
+        MarkDirty(appIndex, titleId, tab);
+    }
+
+    // Convert the aggregates into the shared Session structure.
+    // Applications and tabs are emitted sorted by name, as the log always has been.
+    Session BuildSession(long long startTimestamp, long long endTimestamp, const std::string& comment) const {
+        Session session;
+        session.start_timestamp = startTimestamp;
+        session.end_timestamp = endTimestamp;
+        session.comment = comment;
+        session.applications.reserve(m_applications.size());
+
+        std::vector<uint32_t> order(m_applications.size());
+        for (uint32_t i = 0; i < order.size(); i++) order[i] = i;
+        std::sort(order.begin(), order.end(), [this](uint32_t a, uint32_t b) {
+            return GetString(m_applications[a].nameId) < GetString(m_applications[b].nameId);
+        });
+
+        for (uint32_t appIndex : order) {
+            const ApplicationData& appData = m_applications[appIndex];
+            ApplicationFocusEvent app;
+            app.process_name = std::string(GetString(appData.nameId));
+            app.process_path = std::string(GetString(appData.pathId));
+            app.first_focus_time = appData.first_focus_time;
+            app.last_focus_time = appData.last_focus_time;
+            app.total_time_spent_ms = appData.total_time_ms;
+            app.tabs.reserve(appData.tabs.size());
+
+            for (uint32_t titleId : appData.tabs) {
+                app.tabs.push_back(TabInfo{ std::string(GetString(titleId)), GetTabTime(appIndex, titleId) });
+            }
+            std::sort(app.tabs.begin(), app.tabs.end(), [](const TabInfo& a, const TabInfo& b) {
+                return a.window_title < b.window_title;
+            });
+
+            session.applications.push_back(std::move(app));
+        }
+
+        return session;
+    }
+
+private:
+    struct TabEntry {
+        long long total_time_ms = 0;
+        bool dirty = false;
+    };
+
+    StringInterner m_strings;
+    std::vector<ApplicationData> m_applications;    // Dense, indexed by application index
+    FlatHashMap<uint32_t> m_applicationIndex;       // process name ID -> application index
+    FlatHashMap<TabEntry> m_tabs;                   // (application index, title ID) -> tab totals
+    std::vector<uint32_t> m_dirtyApplications;
+
+    // Current tracking
+    uint32_t m_currentProcessName = StringInterner::INVALID_ID;
+    uint32_t m_currentProcessPath = StringInterner::INVALID_ID;
+    uint32_t m_currentWindowTitle = StringInterner::INVALID_ID;
+    long long m_currentFocusStartTime = 0;
+
+    static uint64_t TabKey(uint32_t appIndex, uint32_t titleId) {
+        return ((uint64_t)appIndex << 32) | titleId;
+    }
+
+    // Applications are keyed by process name; the path of the first sighting sticks
+    uint32_t FindOrAddApplication(uint32_t nameId, uint32_t pathId, long long firstFocusTime) {
+        uint32_t& slot = m_applicationIndex[nameId];
+        if (slot == 0) {
+            ApplicationData appData;
+            appData.nameId = nameId;
+            appData.pathId = pathId;
+            appData.first_focus_time = firstFocusTime;
+            m_applications.push_back(std::move(appData));
+            slot = (uint32_t)m_applications.size();  // Stored +1 so 0 means "new"
+        }
+        return slot - 1;
+    }
+
+    TabEntry& Tab(uint32_t appIndex, uint32_t titleId) {
+        size_t before = m_tabs.Size();
+        TabEntry& tab = m_tabs[TabKey(appIndex, titleId)];
+        if (m_tabs.Size() != before) {
+            m_applications[appIndex].tabs.push_back(titleId);
+        }
+        return tab;
+    }
+
+    void MarkDirty(uint32_t appIndex, uint32_t titleId, TabEntry& tab) {
+        ApplicationData& appData = m_applications[appIndex];
+        if (!appData.dirty) {
+            appData.dirty = true;
+            m_dirtyApplications.push_back(appIndex);
+        }
+        if (!tab.dirty) {
+            tab.dirty = true;
+            appData.dirtyTabs.push_back(titleId);
+        }
+    }
+};
+
+} // namespace bigbrother
@@ -2,98 +2,128 @@
 
 #include <windows.h>
 #include <string>
+#include <string_view>
 #include <psapi.h>
 #include <fstream>
 #include <iostream>
 #include <chrono>
 #include <shlobj.h>
-#include <map>
+#include <cstdio>
+#include <cstring>
+#include <atomic>
+#include <memory>
+#include <thread>
 #include "json.hpp"
 #include "time_utils.h"
+#include "session_data.h"
+#include "session_aggregator.h"
+#include "event_journal.h"
+#include "spsc_ring.h"
+#include "flush_scheduler.h"
+#include "session_writer.h"
+#include "segment_store.h"
+#include "process_identity.h"
+#include "process_cache.h"
 
 using json = nlohmann::json;
 
 namespace bigbrother {
 
 class SessionLogger {
+public:
+    // WinEventProc counters, to see how much of the hook traffic is filtered
+    // out before any work is done
+    struct HookStats {
+        unsigned long long eventsReceived = 0;
+        unsigned long long rejectedNotWindow = 0;       // Child objects, carets, etc.
+        unsigned long long rejectedNotForeground = 0;   // Name changes on background windows
+        unsigned long long rejectedUnchangedTitle = 0;  // Name changes that kept the same title
+        unsigned long long focusChanges = 0;
+        unsigned long long titleChanges = 0;
+        unsigned long long processCacheHits = 0;
+        unsigned long long processCacheMisses = 0;
+        
+        unsigned long long Rejected() const {
+            return rejectedNotWindow + rejectedNotForeground + rejectedUnchangedTitle;
+        }
+    };
+
 private:
     HWINEVENTHOOK m_hFocusHook = NULL;
     HWINEVENTHOOK m_hTitleHook = NULL;
     std::string m_dataFilePath;
     long long m_sessionStart = 0;
-    bool m_sessionActive = false;
-    std::string m_lastFocusedWindowTitle = "";
+    std::string m_sessionComment;
+    std::atomic<bool> m_sessionActive{ false };
+    char m_lastFocusedWindowTitle[256] = "";
     HWND m_lastFocusedWindow = NULL;
     
-    // Current tracking
-    std::string m_currentProcessName;
-    std::string m_currentProcessPath;
-    std::string m_currentWindowTitle;
-    long long m_currentFocusStartTime = 0;
-    
     // Aggregated session data
-    struct TabData {
-        long long total_time_ms = 0;
-    };
+    SessionAggregator m_aggregator;
+    
+    // Append-only journal of the active session (focus_log.journal)
+    EventJournal m_journal;
+    int m_eventsSinceSnapshot = 0;
+    int m_deltasSinceSnapshot = 0;
+    static const int SNAPSHOT_EVENT_INTERVAL = 256;  // Persist changed aggregates every N events
+    static const int DELTAS_PER_SNAPSHOT = 32;       // Full snapshot every N deltas, to bound replay
     
-    struct ApplicationData {
-        std::string process_name;
-        std::string process_path;
-        long long first_focus_time = 0;
-        long long last_focus_time = 0;
-        long long total_time_ms = 0;
-        std::map<std::string, TabData> tabs;  // window_title -> TabData
+    // Fixed-size event handed from the hook thread to the writer thread
+    struct PendingEvent {
+        enum Type : unsigned char { FocusChange, TitleChange };
+        Type type;
+        long long timestamp;
+        char windowTitle[256];
+        ProcessIdentity process;  // Only filled for focus changes
     };
     
-    std::map<std::string, ApplicationData> m_applications;  // process_name -> ApplicationData
+    // Hook callbacks only enqueue; the writer thread owns the aggregator and
+    // journal, so a slow disk never delays WinEventProc.
+    static const size_t EVENT_QUEUE_CAPACITY = 256;
+    std::unique_ptr<SpscRing<PendingEvent, EVENT_QUEUE_CAPACITY>> m_eventQueue;
+    std::thread m_writerThread;
+    HANDLE m_writerWakeEvent = NULL;
+    std::atomic<bool> m_writerStop{ false };
+    std::atomic<unsigned long long> m_droppedEvents{ 0 };
+    
+    // Group commit and open-interval checkpoints (writer thread only)
+    FlushScheduler m_flushScheduler;
     
-    // Incremental write support
-    int m_eventsSinceLastFlush = 0;
-    std::chrono::steady_clock::time_point m_lastFlushTime;
-    static const int FLUSH_EVENT_THRESHOLD = 1;  // Flush on every event for real-time updates
-    static const int FLUSH_TIME_THRESHOLD_SECONDS = 30;  // Flush every 30 seconds
+    JsonStyle m_outputStyle = JsonStyle::Compact;
+    
+    // Finished sessions, one file per day (history\YYYY-MM-DD.json)
+    SegmentStore m_segments;
+    
+    // Written only by the hook thread, read from anywhere
+    struct AtomicHookStats {
+        std::atomic<unsigned long long> eventsReceived{ 0 };
+        std::atomic<unsigned long long> rejectedNotWindow{ 0 };
+        std::atomic<unsigned long long> rejectedNotForeground{ 0 };
+        std::atomic<unsigned long long> rejectedUnchangedTitle{ 0 };
+        std::atomic<unsigned long long> focusChanges{ 0 };
+        std::atomic<unsigned long long> titleChanges{ 0 };
+        std::atomic<unsigned long long> processCacheHits{ 0 };
+        std::atomic<unsigned long long> processCacheMisses{ 0 };
+    } m_hookStats;
+    
+    // PID -> process name/path, so foreground switches between already-seen
+    // processes skip OpenProcess/GetModuleFileNameExA (hook thread only)
+    ProcessIdentityCache m_processCache;
+    
+    // Single-writer increment: no locked read-modify-write on the hot path
+    static void Bump(std::atomic<unsigned long long>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
 
     // Static instance pointer for callbacks
     static SessionLogger* s_instance;
 
     // Helper functions
-    std::string GetWindowTitle(HWND hwnd) {
-        char windowTitle[256];
+    static void ReadWindowTitle(HWND hwnd, char (&windowTitle)[256]) {
         int length = GetWindowTextA(hwnd, windowTitle, sizeof(windowTitle));
-        if (length > 0) {
-            return std::string(windowTitle);
-        }
-        return "Unknown Window";
-    }
-
-    std::string GetProcessInfo(HWND hwnd) {
-        DWORD processId = 0;
-        GetWindowThreadProcessId(hwnd, &processId);
-        
-        if (processId == 0) {
-            return "Unknown Process";
-        }
-        
-        HANDLE hProcess = OpenProcess(PROCESS_QUERY_INFORMATION | PROCESS_VM_READ, FALSE, processId);
-        if (hProcess == NULL) {
-            return "Access Denied (PID: " + std::to_string(processId) + ")";
+        if (length <= 0) {
+            std::snprintf(windowTitle, sizeof(windowTitle), "Unknown Window");
         }
-        
-        char processPath[MAX_PATH];
-        DWORD pathLength = GetModuleFileNameExA(hProcess, NULL, processPath, MAX_PATH);
-        
-        CloseHandle(hProcess);
-        
-        if (pathLength > 0) {
-            std::string fullPath(processPath);
-            size_t lastSlash = fullPath.find_last_of("\\/");
-            std::string processName = (lastSlash != std::string::npos) ? 
-                                     fullPath.substr(lastSlash + 1) : fullPath;
-            
-            return processName + " (" + fullPath + ")";
-        }
-        
-        return "Unknown Process (PID: " + std::to_string(processId) + ")";
     }
 
     std::string GetUserDataPath() const {
@@ -106,183 +136,185 @@ private:
         return "focus_log.json";
     }
 
-    void FinalizeCurrentFocus() {
-        if (m_currentFocusStartTime == 0 || m_currentProcessName.empty()) {
-            return;  // Nothing to finalize
+    // Store a finished session in its day's history segment (replacing a copy
+    // with the same start timestamp). Only that day's file and the manifest
+    // are rewritten, so the cost does not grow with the amount of history.
+    bool WriteSessionToLog(const Session& session) {
+        if (!m_segments.WriteSession(session, m_outputStyle)) {
+            std::cerr << "[ERROR] Could not write session to history segment!" << std::endl;
+            return false;
         }
-        
-        long long currentTime = bigbrother::GetUnixTimestamp();
-        long long timeSpentMs = (currentTime - m_currentFocusStartTime) * 1000;  // Convert seconds to milliseconds
-        
-        // Get or create application entry
-        ApplicationData& appData = m_applications[m_currentProcessName];
-        if (appData.process_name.empty()) {
-            // New application
-            appData.process_name = m_currentProcessName;
-            appData.process_path = m_currentProcessPath;
-            appData.first_focus_time = m_currentFocusStartTime;
-        }
-        
-        // Update application data
-        appData.last_focus_time = currentTime;
-        appData.total_time_ms += timeSpentMs;
-        
-        // Update tab data
-        TabData& tabData = appData.tabs[m_currentWindowTitle];
-        tabData.total_time_ms += timeSpentMs;
-        
-        m_eventsSinceLastFlush++;
+        return true;
     }
     
-    json BuildSessionJSON() {
-        json sessionJson = json::object();
-        sessionJson["start_timestamp"] = m_sessionStart;
-        sessionJson["end_timestamp"] = bigbrother::GetUnixTimestamp();
-        sessionJson["comment"] = "";  // Can be set later
-        sessionJson["applications"] = json::array();
-        
-        for (const auto& [processName, appData] : m_applications) {
-            json appJson = json::object();
-            appJson["process_name"] = appData.process_name;
-            appJson["process_path"] = appData.process_path;
-            appJson["first_focus_time"] = appData.first_focus_time;
-            appJson["last_focus_time"] = appData.last_focus_time;
-            appJson["total_time_spent_ms"] = appData.total_time_ms;
-            appJson["tabs"] = json::array();
-            
-            for (const auto& [windowTitle, tabData] : appData.tabs) {
-                json tabJson = json::object();
-                tabJson["window_title"] = windowTitle;
-                tabJson["total_time_spent_ms"] = tabData.total_time_ms;
-                appJson["tabs"].push_back(tabJson);
-            }
-            
-            sessionJson["applications"].push_back(appJson);
+    // Write a session left in the (open) journal by a crashed/killed run to
+    // its history segment. A journal whose delete failed after a clean stop
+    // holds a session that is already stored, and is skipped. False if the
+    // session could not be stored, so the journal must be kept.
+    bool RecoverJournal() {
+        std::string data;
+        if (!m_journal.ReadContents(data)) {
+            return false;
         }
-        
-        return sessionJson;
+        Session orphaned;
+        if (!JournalReader::Replay(data, orphaned) ||
+            m_segments.HasSession(orphaned.start_timestamp, orphaned.end_timestamp)) {
+            return true;
+        }
+        return WriteSessionToLog(orphaned);
     }
     
+    // Persist the records staged since the last flush. Cost is proportional to
+    // the new records, not to the amount of history already stored.
     void FlushCurrentSession() {
         if (!m_sessionActive) return;
         
-        // Finalize current focus before flushing
-        long long tempFocusStartTime = m_currentFocusStartTime;
-        std::string tempProcessName = m_currentProcessName;
-        std::string tempProcessPath = m_currentProcessPath;
-        std::string tempWindowTitle = m_currentWindowTitle;
-        
-        FinalizeCurrentFocus();
-        
-        // Build session JSON
-        json sessionJson = BuildSessionJSON();
-        
-        // Load existing sessions from file
-        json allSessions;
-        std::ifstream inFile(m_dataFilePath);
-        if (inFile.is_open()) {
-            inFile.seekg(0, std::ios::end);
-            std::streampos fileSize = inFile.tellg();
-            inFile.seekg(0, std::ios::beg);
-            
-            if (fileSize > 0) {
-                try {
-                    inFile >> allSessions;
-                } catch (const json::exception& e) {
-                    allSessions = json::object();
-                    allSessions["sessions"] = json::array();
-                }
+        // Periodically persist the aggregates so replay stays short. Usually
+        // only the applications/tabs touched since the last one are written.
+        if (m_eventsSinceSnapshot >= SNAPSHOT_EVENT_INTERVAL) {
+            long long now = bigbrother::GetUnixTimestamp();
+            m_aggregator.FinalizeCurrentFocus(now);
+            if (m_deltasSinceSnapshot >= DELTAS_PER_SNAPSHOT) {
+                m_journal.AppendSnapshot(now, m_aggregator);
+                m_deltasSinceSnapshot = 0;
             } else {
-                allSessions = json::object();
-                allSessions["sessions"] = json::array();
+                m_journal.AppendDelta(now, m_aggregator);
+                m_deltasSinceSnapshot++;
             }
-            inFile.close();
-        } else {
-            allSessions = json::object();
-            allSessions["sessions"] = json::array();
+            m_aggregator.ClearDirty();
+            m_eventsSinceSnapshot = 0;
         }
         
-        // Check if we already have a session with our start timestamp (incremental update)
-        bool sessionExists = false;
-        for (size_t i = 0; i < allSessions["sessions"].size(); ++i) {
-            if (allSessions["sessions"][i]["start_timestamp"] == m_sessionStart) {
-                // Update existing session
-                allSessions["sessions"][i] = sessionJson;
-                sessionExists = true;
-                break;
-            }
+        if (!m_journal.Commit()) {
+            std::cerr << "[ERROR] Could not write to session journal!" << std::endl;
         }
-        
-        if (!sessionExists) {
-            // Add new session
-            allSessions["sessions"].push_back(sessionJson);
-        }
-        
-        // Write to file
-        std::ofstream outFile(m_dataFilePath);
-        if (outFile.is_open()) {
-            outFile << allSessions.dump(2) << std::endl;
-            outFile.close();
-        } else {
-            std::cerr << "[ERROR] Could not open file for writing!" << std::endl;
-        }
-        
-        // Restore current focus tracking to continue
-        m_currentFocusStartTime = bigbrother::GetUnixTimestamp();
-        m_currentProcessName = tempProcessName;
-        m_currentProcessPath = tempProcessPath;
-        m_currentWindowTitle = tempWindowTitle;
-        
-        // Reset flush counter and timer
-        m_eventsSinceLastFlush = 0;
-        m_lastFlushTime = std::chrono::steady_clock::now();
+        m_flushScheduler.OnCommit();
     }
     
-    bool ShouldFlush() {
-        if (m_eventsSinceLastFlush >= FLUSH_EVENT_THRESHOLD) {
-            return true;
-        }
-        
-        auto now = std::chrono::steady_clock::now();
-        auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(now - m_lastFlushTime);
-        if (elapsed.count() >= FLUSH_TIME_THRESHOLD_SECONDS) {
-            return true;
-        }
-        
-        return false;
+    // Make the open interval durable without waiting for the next event
+    void CheckpointOpenInterval() {
+        long long now = bigbrother::GetUnixTimestamp();
+        m_aggregator.FinalizeCurrentFocus(now);
+        m_journal.AppendCheckpoint(now);
+        m_flushScheduler.OnAppend(FlushScheduler::Clock::now());
+        FlushCurrentSession();
     }
 
-    void LogFocusChange(const std::string& windowTitle, const std::string& processName, const std::string& processPath) {
-        if (!m_sessionActive) return;
+    bool LogFocusChange(long long timestamp, std::string_view windowTitle, std::string_view processName, std::string_view processPath) {
+        if (!m_sessionActive) return false;
         
         // Finalize previous focus
-        FinalizeCurrentFocus();
+        m_aggregator.FinalizeCurrentFocus(timestamp);
         
         // Start new focus
-        m_currentProcessName = processName;
-        m_currentProcessPath = processPath;
-        m_currentWindowTitle = windowTitle;
-        m_currentFocusStartTime = bigbrother::GetUnixTimestamp();
-        
-        // Always flush on every event for real-time updates
-        FlushCurrentSession();
+        m_aggregator.BeginFocus(processName, processPath, windowTitle, timestamp);
+        m_journal.AppendFocus(timestamp, processName, processPath, windowTitle);
+        m_eventsSinceSnapshot++;
+        return true;
     }
 
-    void LogTitleChange(const std::string& windowTitle) {
-        if (!m_sessionActive || m_currentProcessName.empty()) return;
+    bool LogTitleChange(long long timestamp, std::string_view windowTitle) {
+        if (!m_sessionActive || !m_aggregator.HasCurrentFocus()) return false;
         
         // Only log if title actually changed
-        if (windowTitle == m_currentWindowTitle) return;
+        if (windowTitle == m_aggregator.GetCurrentWindowTitle()) return false;
         
         // Finalize current tab time
-        FinalizeCurrentFocus();
+        m_aggregator.FinalizeCurrentFocus(timestamp);
         
         // Start tracking new tab in same application
-        m_currentWindowTitle = windowTitle;
-        m_currentFocusStartTime = bigbrother::GetUnixTimestamp();
+        m_aggregator.BeginTitle(windowTitle, timestamp);
+        m_journal.AppendTitle(timestamp, windowTitle);
+        m_eventsSinceSnapshot++;
+        return true;
+    }
+    
+    // Called on the hook thread: copy the event into the ring and wake the writer
+    void EnqueueEvent(PendingEvent::Type type, const char* windowTitle, const ProcessIdentity* process) {
+        if (!m_eventQueue) return;
+        
+        PendingEvent pending;
+        pending.type = type;
+        pending.timestamp = bigbrother::GetUnixTimestamp();
+        std::memcpy(pending.windowTitle, windowTitle, sizeof(pending.windowTitle));
+        if (process) {
+            pending.process = *process;
+        }
         
-        // Always flush on every event for real-time updates
-        FlushCurrentSession();
+        if (!m_eventQueue->TryPush(pending)) {
+            m_droppedEvents++;  // Writer is far behind; never block the hook
+            return;
+        }
+        SetEvent(m_writerWakeEvent);
+    }
+    
+    // Returns true if the event staged a journal record
+    bool ProcessEvent(const PendingEvent& pending) {
+        if (pending.type == PendingEvent::FocusChange) {
+            std::cout << "Focus changed to: " << pending.windowTitle << std::endl;
+            std::cout << "  Process: " << pending.process.processName << " (" << pending.process.processPath << ")" << std::endl;
+            std::cout << "  ---" << std::endl;
+            
+            return LogFocusChange(pending.timestamp, pending.windowTitle,
+                                  pending.process.processName, pending.process.processPath);
+        } else {
+            std::cout << "Title changed to: " << pending.windowTitle << std::endl;
+            std::cout << "  ---" << std::endl;
+            
+            return LogTitleChange(pending.timestamp, pending.windowTitle);
+        }
+    }
+    
+    // Drains the event ring into the journal buffer and commits on the
+    // scheduler's deadlines rather than once per event
+    void WriterThreadMain() {
+        PendingEvent pending;
+        m_flushScheduler.Reset(FlushScheduler::Clock::now());
+        
+        for (;;) {
+            auto wait = m_flushScheduler.TimeUntilNextDeadline(
+                FlushScheduler::Clock::now(), m_aggregator.HasCurrentFocus());
+            DWORD timeoutMs = wait == std::chrono::milliseconds::max() ? INFINITE : (DWORD)wait.count();
+            WaitForSingleObject(m_writerWakeEvent, timeoutMs);
+            bool stopping = m_writerStop.load();
+            
+            auto now = FlushScheduler::Clock::now();
+            while (m_eventQueue->TryPop(pending)) {
+                if (ProcessEvent(pending)) {
+                    m_flushScheduler.OnAppend(now);
+                }
+            }
+            
+            // StopSession finalizes and persists whatever is still staged
+            if (stopping) break;
+            
+            if (m_aggregator.HasCurrentFocus() && m_flushScheduler.CheckpointDue(now)) {
+                CheckpointOpenInterval();
+            } else if (m_flushScheduler.CommitDue(now)) {
+                FlushCurrentSession();
+            }
+        }
+    }
+    
+    void StartWriterThread() {
+        m_eventQueue.reset(new SpscRing<PendingEvent, EVENT_QUEUE_CAPACITY>());
+        m_writerWakeEvent = CreateEventA(NULL, FALSE, FALSE, NULL);
+        m_writerStop = false;
+        m_writerThread = std::thread(&SessionLogger::WriterThreadMain, this);
+    }
+    
+    // Hook thread only (see StopSession): EnqueueEvent uses the ring without a lock
+    void StopWriterThread() {
+        if (m_writerThread.joinable()) {
+            m_writerStop = true;
+            SetEvent(m_writerWakeEvent);
+            m_writerThread.join();
+        }
+        if (m_writerWakeEvent) {
+            CloseHandle(m_writerWakeEvent);
+            m_writerWakeEvent = NULL;
+        }
+        m_eventQueue.reset();
     }
 
     static void CALLBACK WinEventProc(
@@ -294,47 +326,55 @@ private:
         DWORD dwEventThread,
         DWORD dwmsEventTime
     ) {
-        if (!s_instance || hwnd == NULL) return;
+        SessionLogger* self = s_instance;
+        if (!self || hwnd == NULL || !self->m_sessionActive.load(std::memory_order_relaxed)) return;
         
-        std::string windowTitle = s_instance->GetWindowTitle(hwnd);
-        std::string processInfo = s_instance->GetProcessInfo(hwnd);
+        Bump(self->m_hookStats.eventsReceived);
         
-        std::string processName, processPath;
-        size_t parenPos = processInfo.find(" (");
-        if (parenPos != std::string::npos) {
-            processName = processInfo.substr(0, parenPos);
-            size_t pathStart = parenPos + 2;
-            size_t pathEnd = processInfo.rfind(")");
-            if (pathEnd != std::string::npos && pathEnd > pathStart) {
-                processPath = processInfo.substr(pathStart, pathEnd - pathStart);
-            }
-        } else {
-            processName = processInfo;
-            processPath = "Unknown";
+        // Only top-level window objects carry the titles we track
+        if (idObject != OBJID_WINDOW || idChild != CHILDID_SELF) {
+            Bump(self->m_hookStats.rejectedNotWindow);
+            return;
         }
         
-        if (event == EVENT_SYSTEM_FOREGROUND && idObject == OBJID_WINDOW) {
-            s_instance->m_lastFocusedWindow = hwnd;
-            s_instance->m_lastFocusedWindowTitle = windowTitle;
+        if (event == EVENT_OBJECT_NAMECHANGE) {
+            // Name changes fire system-wide; reject anything that is not the
+            // focused window before making a single syscall
+            if (hwnd != self->m_lastFocusedWindow) {
+                Bump(self->m_hookStats.rejectedNotForeground);
+                return;
+            }
             
-            std::cout << "Focus changed to: " << windowTitle << std::endl;
-            std::cout << "  Process: " << processInfo << std::endl;
-            std::cout << "  ---" << std::endl;
+            char windowTitle[256];
+            ReadWindowTitle(hwnd, windowTitle);
+            if (std::strcmp(windowTitle, self->m_lastFocusedWindowTitle) == 0) {
+                Bump(self->m_hookStats.rejectedUnchangedTitle);
+                return;
+            }
+            std::memcpy(self->m_lastFocusedWindowTitle, windowTitle, sizeof(windowTitle));
             
-            s_instance->LogFocusChange(windowTitle, processName, processPath);
+            // Same window, same process: the writer already knows the identity
+            Bump(self->m_hookStats.titleChanges);
+            self->EnqueueEvent(PendingEvent::TitleChange, windowTitle, nullptr);
         }
-        else if (event == EVENT_OBJECT_NAMECHANGE && idObject == OBJID_WINDOW) {
-            if (hwnd == s_instance->m_lastFocusedWindow && 
-                windowTitle != s_instance->m_lastFocusedWindowTitle && 
-                !windowTitle.empty()) {
-                s_instance->m_lastFocusedWindowTitle = windowTitle;
-                
-                std::cout << "Title changed to: " << windowTitle << std::endl;
-                std::cout << "  Process: " << processInfo << std::endl;
-                std::cout << "  ---" << std::endl;
-                
-                s_instance->LogTitleChange(windowTitle);
+        else if (event == EVENT_SYSTEM_FOREGROUND) {
+            char windowTitle[256];
+            ReadWindowTitle(hwnd, windowTitle);
+            
+            DWORD processId = 0;
+            GetWindowThreadProcessId(hwnd, &processId);
+            ProcessIdentity process;
+            if (self->m_processCache.Lookup(processId, process)) {
+                Bump(self->m_hookStats.processCacheHits);
+            } else {
+                Bump(self->m_hookStats.processCacheMisses);
             }
+            
+            self->m_lastFocusedWindow = hwnd;
+            std::memcpy(self->m_lastFocusedWindowTitle, windowTitle, sizeof(windowTitle));
+            
+            Bump(self->m_hookStats.focusChanges);
+            self->EnqueueEvent(PendingEvent::FocusChange, windowTitle, &process);
         }
     }
 
@@ -350,26 +390,53 @@ public:
         s_instance = nullptr;
     }
 
+    // The calling thread must pump messages: it receives the hook callbacks
     bool StartSession(const std::string& comment = "") {
         if (m_sessionActive) {
             return false; // Already active
         }
 
-        m_sessionStart = bigbrother::GetUnixTimestamp();
-        m_sessionActive = true;
-        
         m_dataFilePath = GetUserDataPath();
+        m_segments.SetDataFilePath(m_dataFilePath);
+        
+        // The journal stays open until StopSession, which keeps any other
+        // recorder (monitor or viewer) from recovering or overwriting it
+        if (!m_journal.Open(GetJournalPath(m_dataFilePath))) {
+            if (GetLastError() == ERROR_SHARING_VIOLATION) {
+                std::cerr << "[ERROR] Another process is already recording a session!" << std::endl;
+            } else {
+                std::cerr << "[ERROR] Could not create session journal!" << std::endl;
+            }
+            return false;
+        }
+        
+        // A journal with records means the previous session never stopped cleanly
+        if (!RecoverJournal()) {
+            std::cerr << "[ERROR] Could not recover the previous session from its journal!" << std::endl;
+            m_journal.Close();
+            return false;
+        }
+        
+        m_sessionStart = bigbrother::GetUnixTimestamp();
+        m_sessionComment = comment;
         
         // Initialize tracking variables
-        m_applications.clear();
-        m_currentProcessName.clear();
-        m_currentProcessPath.clear();
-        m_currentWindowTitle.clear();
-        m_currentFocusStartTime = 0;
+        m_aggregator.Reset();
         
-        // Initialize flush tracking
-        m_eventsSinceLastFlush = 0;
-        m_lastFlushTime = std::chrono::steady_clock::now();
+        // Start a fresh journal for this session
+        if (!m_journal.Truncate()) {
+            std::cerr << "[ERROR] Could not create session journal!" << std::endl;
+            m_journal.Close();
+            return false;
+        }
+        m_journal.AppendSessionStart(m_sessionStart, m_sessionComment);
+        m_journal.Commit();
+        m_eventsSinceSnapshot = 0;
+        m_deltasSinceSnapshot = 0;
+        m_sessionActive = true;
+        
+        // Writer must be running before the hooks start producing events
+        StartWriterThread();
         
         // Set up hooks
         m_hFocusHook = SetWinEventHook(
@@ -395,6 +462,9 @@ public:
         return (m_hFocusHook != NULL && m_hTitleHook != NULL);
     }
 
+    // Call on the thread that called StartSession. Its message loop
+    // dispatches WinEventProc, so no callback can be using the event ring
+    // or the process cache while they are torn down here.
     void StopSession() {
         if (!m_sessionActive) return;
         
@@ -408,60 +478,31 @@ public:
             m_hTitleHook = NULL;
         }
         
+        // Release the process handles pinned by the identity cache. The cache
+        // belongs to the hook thread, which is this one (see above).
+        m_processCache.Clear();
+        
+        // Let the writer persist everything already queued, then take over its state
+        StopWriterThread();
         m_sessionActive = false;
         
         // Finalize current focus
-        FinalizeCurrentFocus();
-        
-        // Build final session JSON
-        json sessionJson = BuildSessionJSON();
-        
-        // Load existing sessions from file
-        json allSessions;
-        std::ifstream inFile(m_dataFilePath);
-        if (inFile.is_open()) {
-            inFile.seekg(0, std::ios::end);
-            std::streampos fileSize = inFile.tellg();
-            inFile.seekg(0, std::ios::beg);
-            
-            if (fileSize > 0) {
-                try {
-                    inFile >> allSessions;
-                } catch (const json::exception& e) {
-                    allSessions = json::object();
-                    allSessions["sessions"] = json::array();
-                }
-            } else {
-                allSessions = json::object();
-                allSessions["sessions"] = json::array();
-            }
-            inFile.close();
-        } else {
-            allSessions = json::object();
-            allSessions["sessions"] = json::array();
-        }
-        
-        // Check if we already have a session with our start timestamp
-        bool sessionExists = false;
-        for (size_t i = 0; i < allSessions["sessions"].size(); ++i) {
-            if (allSessions["sessions"][i]["start_timestamp"] == m_sessionStart) {
-                // Update existing session
-                allSessions["sessions"][i] = sessionJson;
-                sessionExists = true;
-                break;
-            }
-        }
-        
-        if (!sessionExists) {
-            // Add new session
-            allSessions["sessions"].push_back(sessionJson);
-        }
-        
-        // Write to file
-        std::ofstream outFile(m_dataFilePath);
-        if (outFile.is_open()) {
-            outFile << allSessions.dump(2) << std::endl;
-            outFile.close();
+        long long now = bigbrother::GetUnixTimestamp();
+        m_aggregator.FinalizeCurrentFocus(now);
+        
+        // Journal the stop time too, so that replaying this journal (should
+        // the delete below fail) gives exactly the session stored here
+        m_journal.AppendCheckpoint(now);
+        m_journal.Commit();
+        
+        Session session = m_aggregator.BuildSession(m_sessionStart, now, m_sessionComment);
+        
+        // Store the session in its day's history segment, then drop the journal.
+        // If the write fails the journal is kept and recovered on the next start.
+        bool written = WriteSessionToLog(session);
+        m_journal.Close();
+        if (written) {
+            std::remove(GetJournalPath(m_dataFilePath).c_str());
         }
     }
 
@@ -469,10 +510,50 @@ public:
         return m_sessionActive;
     }
 
+    // Upper bound on how long a recorded event may sit in memory before it is
+    // written to the journal. Takes effect on the next StartSession.
+    void SetDurabilityDeadline(std::chrono::milliseconds deadline) {
+        m_flushScheduler.SetDurabilityDeadline(deadline);
+    }
+
+    // How often an open focus interval is checkpointed when no events arrive.
+    // Takes effect on the next StartSession.
+    void SetCheckpointInterval(std::chrono::milliseconds interval) {
+        m_flushScheduler.SetCheckpointInterval(interval);
+    }
+
+    // Layout of the history segments. Compact by default; Pretty keeps them hand-readable.
+    void SetOutputStyle(JsonStyle style) {
+        m_outputStyle = style;
+    }
+
+    HookStats GetHookStats() const {
+        HookStats stats;
+        stats.eventsReceived = m_hookStats.eventsReceived.load(std::memory_order_relaxed);
+        stats.rejectedNotWindow = m_hookStats.rejectedNotWindow.load(std::memory_order_relaxed);
+        stats.rejectedNotForeground = m_hookStats.rejectedNotForeground.load(std::memory_order_relaxed);
+        stats.rejectedUnchangedTitle = m_hookStats.rejectedUnchangedTitle.load(std::memory_order_relaxed);
+        stats.focusChanges = m_hookStats.focusChanges.load(std::memory_order_relaxed);
+        stats.titleChanges = m_hookStats.titleChanges.load(std::memory_order_relaxed);
+        stats.processCacheHits = m_hookStats.processCacheHits.load(std::memory_order_relaxed);
+        stats.processCacheMisses = m_hookStats.processCacheMisses.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+    // Events discarded because the writer fell a full queue behind
+    unsigned long long GetDroppedEventCount() const {
+        return m_droppedEvents.load();
+    }
+
     std::string GetDataFilePath() const {
         return m_dataFilePath.empty() ? GetUserDataPath() : m_dataFilePath;
     }
 
+    // Where finished sessions are stored, one file per day
+    std::string GetHistoryDirectory() const {
+        return SegmentStore(GetDataFilePath()).GetHistoryDirectory();
+    }
+
     long long GetSessionStartTime() const {
         return m_sessionStart;
     }
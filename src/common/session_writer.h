@@ -0,0 +1,261 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <ostream>
+#include <fstream>
+#include <charconv>
+#include "session_data.h"
+
+namespace bigbrother {
+
+enum class JsonStyle {
+    Pretty,   // 2-space indentation, same layout as nlohmann's dump(2)
+    Compact   // No whitespace; roughly half the bytes
+};
+
+// Streaming JSON writer.
+//
+// Emits values straight into a byte buffer instead of building a DOM first.
+// With a sink attached, the buffer is handed to the stream whenever it grows
+// past FLUSH_THRESHOLD, so writing the whole history needs only a bounded
+// amount of memory on top of the data being written.
+class JsonStreamWriter {
+public:
+    static constexpr size_t FLUSH_THRESHOLD = 64 * 1024;
+
+    explicit JsonStreamWriter(JsonStyle style = JsonStyle::Compact, std::ostream* sink = nullptr)
+        : m_style(style), m_sink(sink) {}
+
+    void BeginObject() { BeginValue(); m_buffer.push_back('{'); Open(); }
+    void EndObject() { Close('}'); }
+    void BeginArray() { BeginValue(); m_buffer.push_back('['); Open(); }
+    void EndArray() { Close(']'); }
+
+    void Key(std::string_view key) {
+        Separator();
+        AppendEscaped(m_buffer, key);
+        m_buffer.append(m_style == JsonStyle::Pretty ? ": " : ":");
+        m_afterKey = true;
+    }
+
+    void String(std::string_view value) {
+        BeginValue();
+        AppendEscaped(m_buffer, value);
+    }
+
+    void Int(long long value) {
+        BeginValue();
+        char digits[24];
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        m_buffer.append(digits, result.ptr - digits);
+    }
+
+    // Already-serialized JSON value, copied byte for byte. In Pretty style its
+    // inner lines must already be indented for the current depth (as they are
+    // when it was written at the same place before).
+    void Raw(std::string_view json) {
+        BeginValue();
+        m_buffer.append(json.data(), json.size());
+    }
+
+    void Newline() {
+        m_buffer.push_back('\n');
+    }
+
+    // Hand buffered bytes to the sink at a convenient boundary if enough piled up
+    bool MaybeFlush() {
+        return m_buffer.size() < FLUSH_THRESHOLD || Flush();
+    }
+
+    bool Flush() {
+        if (!m_sink) return true;
+        m_sink->write(m_buffer.data(), (std::streamsize)m_buffer.size());
+        m_buffer.clear();
+        return m_sink->good();
+    }
+
+    const std::string& GetBuffer() const { return m_buffer; }
+    std::string& GetBuffer() { return m_buffer; }
+
+    // JSON string literal for `value`. Control characters are escaped and bytes
+    // that are not valid UTF-8 (e.g. ANSI window titles) become U+FFFD, so any
+    // conforming parser - nlohmann included - accepts the output.
+    static void AppendEscaped(std::string& out, std::string_view value) {
+        static const char HEX[] = "0123456789abcdef";
+        out.push_back('"');
+        size_t i = 0;
+        while (i < value.size()) {
+            unsigned char c = (unsigned char)value[i];
+            if (c >= 0x80) {
+                size_t length = Utf8SequenceLength(value, i);
+                if (length == 0) {
+                    out.append("\xEF\xBF\xBD");
+                    i++;
+                } else {
+                    out.append(value.data() + i, length);
+                    i += length;
+                }
+                continue;
+            }
+            switch (c) {
+            case '"':  out.append("\\\""); break;
+            case '\\': out.append("\\\\"); break;
+            case '\b': out.append("\\b"); break;
+            case '\f': out.append("\\f"); break;
+            case '\n': out.append("\\n"); break;
+            case '\r': out.append("\\r"); break;
+            case '\t': out.append("\\t"); break;
+            default:
+                if (c < 0x20) {
+                    out.append("\\u00");
+                    out.push_back(HEX[c >> 4]);
+                    out.push_back(HEX[c & 0xF]);
+                } else {
+                    out.push_back((char)c);
+                }
+                break;
+            }
+            i++;
+        }
+        out.push_back('"');
+    }
+
+private:
+    JsonStyle m_style;
+    std::ostream* m_sink;
+    std::string m_buffer;
+    int m_depth = 0;
+    bool m_first = true;     // No value written yet at the current depth
+    bool m_afterKey = false; // Next value completes a "key": pair
+
+    void Separator() {
+        if (!m_first) m_buffer.push_back(',');
+        if (m_style == JsonStyle::Pretty && m_depth > 0) {
+            m_buffer.push_back('\n');
+            m_buffer.append(m_depth * 2, ' ');
+        }
+        m_first = false;
+    }
+
+    void BeginValue() {
+        if (m_afterKey) {
+            m_afterKey = false;
+            return;
+        }
+        Separator();
+    }
+
+    void Open() {
+        m_depth++;
+        m_first = true;
+    }
+
+    void Close(char bracket) {
+        m_depth--;
+        if (m_style == JsonStyle::Pretty && !m_first) {
+            m_buffer.push_back('\n');
+            m_buffer.append(m_depth * 2, ' ');
+        }
+        m_buffer.push_back(bracket);
+        m_first = false;
+    }
+
+    // Length of the well-formed UTF-8 sequence at `pos`, 0 if it is malformed
+    static size_t Utf8SequenceLength(std::string_view s, size_t pos) {
+        unsigned char c = (unsigned char)s[pos];
+        size_t length;
+        unsigned char low = 0x80, high = 0xBF;
+        if (c >= 0xC2 && c <= 0xDF) length = 2;
+        else if (c >= 0xE0 && c <= 0xEF) {
+            length = 3;
+            if (c == 0xE0) low = 0xA0;
+            if (c == 0xED) high = 0x9F;  // No surrogates
+        } else if (c >= 0xF0 && c <= 0xF4) {
+            length = 4;
+            if (c == 0xF0) low = 0x90;
+            if (c == 0xF4) high = 0x8F;
+        } else {
+            return 0;
+        }
+        if (pos + length > s.size()) return 0;
+        for (size_t k = 1; k < length; k++) {
+            unsigned char cc = (unsigned char)s[pos + k];
+            if (cc < (k == 1 ? low : 0x80) || cc > (k == 1 ? high : 0xBF)) return 0;
+        }
+        return length;
+    }
+};
+
+inline void WriteTabJson(JsonStreamWriter& writer, const TabInfo& tab) {
+    writer.BeginObject();
+    writer.Key("window_title");
+    writer.String(tab.window_title);
+    writer.Key("total_time_spent_ms");
+    writer.Int(tab.total_time_spent_ms);
+    writer.EndObject();
+}
+
+inline void WriteApplicationJson(JsonStreamWriter& writer, const ApplicationFocusEvent& app) {
+    writer.BeginObject();
+    writer.Key("process_name");
+    writer.String(app.process_name);
+    writer.Key("process_path");
+    writer.String(app.process_path);
+    writer.Key("first_focus_time");
+    writer.Int(app.first_focus_time);
+    writer.Key("last_focus_time");
+    writer.Int(app.last_focus_time);
+    writer.Key("total_time_spent_ms");
+    writer.Int(app.total_time_spent_ms);
+    writer.Key("tabs");
+    writer.BeginArray();
+    for (const auto& tab : app.tabs) {
+        WriteTabJson(writer, tab);
+    }
+    writer.EndArray();
+    writer.EndObject();
+}
+
+// One element of the "sessions" array, in the focus_log.json schema
+inline void WriteSessionJson(JsonStreamWriter& writer, const Session& session) {
+    writer.BeginObject();
+    writer.Key("start_timestamp");
+    writer.Int(session.start_timestamp);
+    writer.Key("end_timestamp");
+    writer.Int(session.end_timestamp);
+    writer.Key("comment");
+    writer.String(session.comment);
+    writer.Key("applications");
+    writer.BeginArray();
+    for (const auto& app : session.applications) {
+        WriteApplicationJson(writer, app);
+    }
+    writer.EndArray();
+    writer.EndObject();
+}
+
+// Write a complete {"sessions": [...]} document to `filePath`
+inline bool WriteSessionsFile(const std::string& filePath, const std::vector<Session>& sessions,
+                              JsonStyle style = JsonStyle::Compact) {
+    std::ofstream outFile(filePath, std::ios::binary);
+    if (!outFile.is_open()) {
+        return false;
+    }
+
+    JsonStreamWriter writer(style, &outFile);
+    writer.BeginObject();
+    writer.Key("sessions");
+    writer.BeginArray();
+    for (const auto& session : sessions) {
+        WriteSessionJson(writer, session);
+        if (!writer.MaybeFlush()) return false;
+    }
+    writer.EndArray();
+    writer.EndObject();
+    writer.Newline();
+    return writer.Flush();
+}
+
+} // namespace bigbrother
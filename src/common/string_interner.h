@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace bigbrother {
+
+inline uint64_t HashBytes(const char* data, size_t length) {
+    uint64_t hash = 14695981039346656037ull;  // FNV-1a
+    for (size_t i = 0; i < length; i++) {
+        hash ^= (unsigned char)data[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+// Maps strings to dense 32-bit IDs and back.
+//
+// Each distinct string is stored once in a chunked arena (views stay valid
+// until Clear), and looking up a string that is already interned does not
+// allocate. IDs are assigned in first-seen order starting at 0.
+class StringInterner {
+public:
+    static constexpr uint32_t INVALID_ID = 0xFFFFFFFFu;
+
+    uint32_t Intern(std::string_view text) {
+        uint64_t hash = HashBytes(text.data(), text.size());
+        size_t slot = Probe(text, hash);
+        if (m_table[slot] != EMPTY) {
+            return m_table[slot];
+        }
+
+        uint32_t id = (uint32_t)m_strings.size();
+        m_strings.push_back(Store(text));
+        m_hashes.push_back(hash);
+        m_table[slot] = id;
+
+        if (m_strings.size() * 2 > m_table.size()) {
+            Grow();
+        }
+        return id;
+    }
+
+    // ID of `text` if it was interned before, INVALID_ID otherwise
+    uint32_t Find(std::string_view text) const {
+        if (m_strings.empty()) return INVALID_ID;
+        size_t slot = Probe(text, HashBytes(text.data(), text.size()));
+        return m_table[slot] == EMPTY ? INVALID_ID : m_table[slot];
+    }
+
+    std::string_view Get(uint32_t id) const {
+        return id < m_strings.size() ? m_strings[id] : std::string_view();
+    }
+
+    size_t Size() const {
+        return m_strings.size();
+    }
+
+    void Clear() {
+        m_strings.clear();
+        m_hashes.clear();
+        m_table.assign(INITIAL_TABLE_SIZE, EMPTY);
+        m_blocks.clear();
+        m_blockUsed = m_blockSize = 0;
+    }
+
+private:
+    static constexpr uint32_t EMPTY = 0xFFFFFFFFu;
+    static constexpr size_t INITIAL_TABLE_SIZE = 64;
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    std::vector<std::string_view> m_strings;          // id -> text (points into m_blocks)
+    std::vector<uint64_t> m_hashes;                   // id -> hash, so growing never rehashes text
+    std::vector<uint32_t> m_table = std::vector<uint32_t>(INITIAL_TABLE_SIZE, EMPTY);
+    std::vector<std::unique_ptr<char[]>> m_blocks;
+    size_t m_blockUsed = 0;
+    size_t m_blockSize = 0;
+
+    // Slot holding `text`, or the empty slot where it would go (linear probing)
+    size_t Probe(std::string_view text, uint64_t hash) const {
+        size_t mask = m_table.size() - 1;
+        for (size_t slot = (size_t)hash & mask; ; slot = (slot + 1) & mask) {
+            uint32_t id = m_table[slot];
+            if (id == EMPTY) return slot;
+            if (m_hashes[id] == hash && m_strings[id] == text) return slot;
+        }
+    }
+
+    void Grow() {
+        std::vector<uint32_t> table(m_table.size() * 2, EMPTY);
+        size_t mask = table.size() - 1;
+        for (uint32_t id = 0; id < m_strings.size(); id++) {
+            size_t slot = (size_t)m_hashes[id] & mask;
+            while (table[slot] != EMPTY) slot = (slot + 1) & mask;
+            table[slot] = id;
+        }
+        m_table.swap(table);
+    }
+
+    std::string_view Store(std::string_view text) {
+        if (text.empty()) return std::string_view();
+        if (m_blockUsed + text.size() > m_blockSize) {
+            m_blockSize = text.size() > BLOCK_SIZE ? text.size() : BLOCK_SIZE;
+            m_blocks.emplace_back(new char[m_blockSize]);
+            m_blockUsed = 0;
+        }
+        char* dest = m_blocks.back().get() + m_blockUsed;
+        std::memcpy(dest, text.data(), text.size());
+        m_blockUsed += text.size();
+        return std::string_view(dest, text.size());
+    }
+};
+
+} // namespace bigbrother
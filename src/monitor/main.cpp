@@ -1,13 +1,33 @@
 #include <windows.h>
 #include <iostream>
+#include <iomanip>
+#include <atomic>
 #include "session_logger.h"
 
 using namespace bigbrother;
 
 // Global state
 SessionLogger g_logger;
-bool g_shouldExit = false;
-bool g_shutdownInProgress = false;
+std::atomic<bool> g_shutdownInProgress{ false };
+DWORD g_mainThreadId = 0;         // Runs the message loop that dispatches the hooks
+HANDLE g_shutdownDone = NULL;     // Set once main has stopped the session
+
+// Print how much hook traffic was filtered before doing any work
+void PrintHookStats() {
+    SessionLogger::HookStats stats = g_logger.GetHookStats();
+    double rejectedPercent = stats.eventsReceived > 0 ?
+        100.0 * (double)stats.Rejected() / (double)stats.eventsReceived : 0.0;
+    
+    std::cout << "Hook events: " << stats.eventsReceived << " received, "
+              << stats.Rejected() << " rejected (" << std::fixed << std::setprecision(1) << rejectedPercent << "%)" << std::endl;
+    std::cout << "  Not a window: " << stats.rejectedNotWindow
+              << ", background window: " << stats.rejectedNotForeground
+              << ", unchanged title: " << stats.rejectedUnchangedTitle << std::endl;
+    std::cout << "  Focus changes: " << stats.focusChanges
+              << ", title changes: " << stats.titleChanges << std::endl;
+    std::cout << "  Process cache: " << stats.processCacheHits << " hits, "
+              << stats.processCacheMisses << " misses" << std::endl;
+}
 
 // Console control handler for Ctrl+C
 BOOL WINAPI ConsoleCtrlHandler(DWORD dwCtrlType) {
@@ -17,16 +37,18 @@ BOOL WINAPI ConsoleCtrlHandler(DWORD dwCtrlType) {
         case CTRL_BREAK_EVENT:
         case CTRL_LOGOFF_EVENT:
         case CTRL_SHUTDOWN_EVENT:
-            if (g_shutdownInProgress) {
+            if (g_shutdownInProgress.exchange(true)) {
                 return TRUE;
             }
-            g_shutdownInProgress = true;
             
             std::cout << "\nShutting down gracefully..." << std::endl;
-            g_shouldExit = true;
-            g_logger.StopSession();
             
-            std::cout << "Program exited successfully." << std::endl;
+            // This handler runs on its own thread while hook callbacks may
+            // still be in flight on the main thread, so the session is
+            // stopped there once its message loop ends. Returning early would
+            // let Windows end the process on close/logoff/shutdown.
+            PostThreadMessage(g_mainThreadId, WM_QUIT, 0, 0);
+            WaitForSingleObject(g_shutdownDone, INFINITE);
             ExitProcess(0);
         default:
             return FALSE;
@@ -37,7 +59,12 @@ int main() {
     std::cout << "BigBrother Window Focus & Title Monitor Started" << std::endl;
     std::cout << "Press Ctrl+C to exit..." << std::endl;
     
-    // Set up console control handler for graceful shutdown
+    // Set up console control handler for graceful shutdown. The peek creates
+    // this thread's message queue, so the handler's WM_QUIT cannot be lost.
+    MSG msg;
+    PeekMessage(&msg, NULL, WM_USER, WM_USER, PM_NOREMOVE);
+    g_mainThreadId = GetCurrentThreadId();
+    g_shutdownDone = CreateEventA(NULL, TRUE, FALSE, NULL);
     SetConsoleCtrlHandler(ConsoleCtrlHandler, TRUE);
     
     // Start monitoring session
@@ -46,21 +73,20 @@ int main() {
         return 1;
     }
     
-    std::cout << "Session started. Data will be saved to: " << g_logger.GetDataFilePath() << std::endl;
+    std::cout << "Session started. Data will be saved to: " << g_logger.GetHistoryDirectory() << std::endl;
     std::cout << "Hooks installed successfully. Monitoring window focus and title changes..." << std::endl;
     
-    // Message loop to keep the program running
-    MSG msg;
-    while (!g_shouldExit && GetMessage(&msg, NULL, 0, 0) > 0) {
+    // Message loop to keep the program running; the Ctrl+C handler ends it with WM_QUIT
+    while (GetMessage(&msg, NULL, 0, 0) > 0) {
         TranslateMessage(&msg);
         DispatchMessage(&msg);
     }
     
-    // Clean up (fallback cleanup if not already done by Ctrl+C handler)
-    if (!g_shutdownInProgress) {
-        g_logger.StopSession();
-        std::cout << "Program exited successfully." << std::endl;
-    }
+    // Stop on the hook thread, so no WinEventProc can be running meanwhile
+    g_logger.StopSession();
+    PrintHookStats();
+    std::cout << "Program exited successfully." << std::endl;
+    SetEvent(g_shutdownDone);
     
     return 0;
 }
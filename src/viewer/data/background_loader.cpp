@@ -0,0 +1,176 @@
+#include "background_loader.h"
+#include <algorithm>
+#include <exception>
+
+namespace bigbrother {
+namespace viewer {
+
+BackgroundLoader::BackgroundLoader() {
+}
+
+BackgroundLoader::~BackgroundLoader() {
+    Stop();
+}
+
+void BackgroundLoader::Start(const std::string& filePath, LoadMode mode) {
+    Stop();
+    m_filePath = filePath;
+    m_mode = mode;
+    m_stop = false;
+    m_refreshPending = true;
+    m_thread = std::thread(&BackgroundLoader::Run, this);
+}
+
+void BackgroundLoader::Stop() {
+    if (!m_thread.joinable()) {
+        return;
+    }
+    Post([this]() { m_stop = true; });
+    m_thread.join();
+}
+
+void BackgroundLoader::RequestRefresh() {
+    Post([this]() { m_refreshPending = true; });
+}
+
+void BackgroundLoader::RequestFullReload() {
+    Post([this]() { m_fullReloadPending = true; });
+}
+
+void BackgroundLoader::RequestLoadEarlier(size_t segments) {
+    Post([this, segments]() { m_extendBy += segments; });
+}
+
+void BackgroundLoader::RequestDelete(long long startTimestamp) {
+    Post([this, startTimestamp]() { m_pendingDeletes.push_back(startTimestamp); });
+}
+
+void BackgroundLoader::Post(const std::function<void()>& update) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        update();
+    }
+    m_wake.notify_one();
+}
+
+bool BackgroundLoader::GetProgress(float& fraction) const {
+    if (!m_busy.load()) {
+        return false;
+    }
+    const LoadProgress& progress = m_loader.GetProgress();
+    uint64_t total = progress.bytesTotal.load();
+    if (total < PROGRESS_MIN_BYTES) {
+        return false;
+    }
+    fraction = std::min(1.0f, (float)((double)progress.bytesDone.load() / (double)total));
+    return true;
+}
+
+void BackgroundLoader::Run() {
+    for (;;) {
+        bool fullReload;
+        size_t extendBy;
+        std::vector<long long> deletes;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this]() {
+                return m_stop || m_refreshPending || m_fullReloadPending || m_extendBy > 0 || !m_pendingDeletes.empty();
+            });
+            if (m_stop) {
+                return;
+            }
+            // Everything queued so far is served by one refresh
+            fullReload = m_fullReloadPending;
+            extendBy = m_extendBy;
+            deletes.swap(m_pendingDeletes);
+            m_refreshPending = false;
+            m_fullReloadPending = false;
+            m_extendBy = 0;
+            m_busy = true;
+        }
+        
+        // Loads the user asked for show their progress from the start. A
+        // refresh after a file change wakes the UI only if it publishes.
+        bool announce = m_generation == 0 || fullReload || extendBy > 0 || !deletes.empty();
+        if (announce) {
+            NotifyUpdate();
+        }
+
+        size_t firstChanged = m_sessions.size();
+        try {
+            for (long long startTimestamp : deletes) {
+                for (size_t i = 0; i < m_sessions.size(); i++) {
+                    if (m_sessions[i].start_timestamp == startTimestamp) {
+                        if (m_loader.DeleteSession(m_filePath, m_sessions, (int)i)) {
+                            firstChanged = std::min(firstChanged, i);
+                        }
+                        break;
+                    }
+                }
+            }
+            if (extendBy > 0) {
+                m_loader.ExtendLazyWindow(extendBy);
+            }
+            if (fullReload) {
+                m_loader.InvalidateCache();
+            }
+            firstChanged = std::min(firstChanged, m_loader.Refresh(m_filePath, m_sessions, m_mode));
+        } catch (const std::exception& e) {
+            // If loading fails, clear sessions to prevent crashes
+            m_sessions.clear();
+            m_loader.InvalidateCache();
+            firstChanged = 0;
+        }
+
+        bool publish = m_generation == 0 || firstChanged < m_publishedCount || m_sessions.size() != m_publishedCount;
+        if (publish) {
+            Publish(firstChanged);
+        }
+        m_busy = false;
+        if (announce || publish) {
+            NotifyUpdate();
+        }
+    }
+}
+
+void BackgroundLoader::NotifyUpdate() {
+    if (m_updateCallback) {
+        m_updateCallback();
+    }
+}
+
+void BackgroundLoader::Publish(size_t firstChanged) {
+    // Settled days are shared with the previous snapshot unless they changed
+    size_t settled = std::min(m_loader.GetSettledSessionCount(), m_sessions.size());
+    if (!m_settled || m_settled->size() != settled || firstChanged < settled) {
+        // Only the changed part is uncounted (from the previous settled list)
+        // and counted again, so a delete or an appended day costs the sessions
+        // after it, not the whole history
+        size_t counted = m_settled ? m_settled->size() : 0;
+        size_t unchanged = std::min({ firstChanged, counted, settled });
+        for (size_t i = unchanged; i < counted; i++) {
+            m_settledStats.Remove((*m_settled)[i]);
+        }
+        for (size_t i = unchanged; i < settled; i++) {
+            m_settledStats.Add(m_sessions[i]);
+        }
+        m_settled = std::make_shared<const std::vector<SessionHeader>>(m_sessions.begin(),
+                                                                       m_sessions.begin() + settled);
+    }
+    std::vector<SessionHeader> recent(m_sessions.begin() + settled, m_sessions.end());
+
+    // Only today's sessions are counted again for each publish
+    SessionStats stats = m_settledStats;
+    for (const SessionHeader& session : recent) {
+        stats.Add(session);
+    }
+
+    auto snapshot = std::make_shared<const SessionSnapshot>(m_settled, std::move(recent),
+                                                            m_loader.GetUnloadedSegmentCount(), ++m_generation,
+                                                            std::move(stats));
+    std::atomic_store(&m_snapshot, std::shared_ptr<const SessionSnapshot>(std::move(snapshot)));
+    m_publishedCount = m_sessions.size();
+}
+
+} // namespace viewer
+} // namespace bigbrother
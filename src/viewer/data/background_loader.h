@@ -0,0 +1,130 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "session_loader.h"
+#include "session_snapshot.h"
+
+namespace bigbrother {
+namespace viewer {
+
+/**
+ * @brief Runs SessionLoader on a worker thread and publishes snapshots
+ *
+ * Requests from the UI are queued and coalesced; the worker applies them
+ * with SessionLoader::Refresh and then publishes a new immutable
+ * SessionSnapshot. The UI picks it up with GetSnapshot, an atomic load of a
+ * shared_ptr, so frames never wait for the disk or the parser.
+ */
+class BackgroundLoader {
+public:
+    /** @brief Loads smaller than this are not worth a progress bar */
+    static constexpr uint64_t PROGRESS_MIN_BYTES = 4 << 20;
+
+    BackgroundLoader();
+    ~BackgroundLoader();
+    BackgroundLoader(const BackgroundLoader&) = delete;
+    BackgroundLoader& operator=(const BackgroundLoader&) = delete;
+
+    /**
+     * @brief Function called on the worker thread whenever the UI has something new to show
+     *
+     * Called when a requested load (first load, full reload, load earlier,
+     * delete) starts and ends, and after any run that published a snapshot,
+     * so a UI that only draws on events can wake up. A refresh that finds
+     * nothing new stays silent.
+     * Must be set before Start.
+     */
+    void SetUpdateCallback(std::function<void()> callback) { m_updateCallback = std::move(callback); }
+
+    /**
+     * @brief Start the worker and queue the initial load
+     * @param filePath Path to focus_log.json
+     * @param mode Full or Lazy, as for SessionLoader::LoadFromFile
+     */
+    void Start(const std::string& filePath, LoadMode mode);
+
+    /**
+     * @brief Stop the worker; a load in progress is finished first
+     */
+    void Stop();
+
+    /**
+     * @brief Re-read whatever changed on disk
+     */
+    void RequestRefresh();
+
+    /**
+     * @brief Re-read everything, ignoring cached state
+     */
+    void RequestFullReload();
+
+    /**
+     * @brief Widen the lazy window by `segments` older days and reload
+     */
+    void RequestLoadEarlier(size_t segments);
+
+    /**
+     * @brief Delete a session from disk (identified by its start time), then refresh
+     */
+    void RequestDelete(long long startTimestamp);
+
+    /**
+     * @brief Latest published snapshot; null until the first load finishes
+     */
+    std::shared_ptr<const SessionSnapshot> GetSnapshot() const { return std::atomic_load(&m_snapshot); }
+
+    /**
+     * @brief True while the worker is applying requests
+     */
+    bool IsLoading() const { return m_busy.load(); }
+
+    /**
+     * @brief Progress of a large load
+     * @param fraction Receives 0..1
+     * @return false if no load worth reporting is running
+     */
+    bool GetProgress(float& fraction) const;
+
+private:
+    SessionLoader m_loader;       // Only touched by the worker thread
+    std::string m_filePath;
+    LoadMode m_mode = LoadMode::Full;
+
+    // Worker-side state
+    std::vector<SessionHeader> m_sessions;
+    std::shared_ptr<const std::vector<SessionHeader>> m_settled;
+    SessionStats m_settledStats;      // Statistics of m_settled
+    size_t m_publishedCount = 0;
+    uint64_t m_generation = 0;
+
+    // Read by the UI with std::atomic_load
+    std::shared_ptr<const SessionSnapshot> m_snapshot;
+
+    // Pending requests, guarded by m_mutex
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    bool m_stop = false;
+    bool m_refreshPending = false;
+    bool m_fullReloadPending = false;
+    size_t m_extendBy = 0;
+    std::vector<long long> m_pendingDeletes;
+
+    std::atomic<bool> m_busy{ false };
+    std::function<void()> m_updateCallback;
+
+    void Run();
+    void Publish(size_t firstChanged);
+    void Post(const std::function<void()>& update);
+    void NotifyUpdate();
+};
+
+} // namespace viewer
+} // namespace bigbrother
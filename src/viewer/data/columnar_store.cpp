@@ -0,0 +1,448 @@
+#include "columnar_store.h"
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include "string_interner.h"
+
+namespace bigbrother {
+namespace viewer {
+
+struct ColumnarStore::Header {
+    char magic[4];
+    uint32_t version;
+    uint64_t sourceSize;
+    uint64_t sourceWriteTime;
+    uint64_t sourceContentHash;
+    int64_t baseTimestamp;        // Timestamps are stored as u32 deltas from this
+    uint32_t sessionCount;
+    uint32_t applicationCount;
+    uint32_t tabCount;
+    uint32_t stringCount;
+    uint64_t sessionsOffset;
+    uint64_t applicationsOffset;
+    uint64_t tabsOffset;
+    uint64_t stringsOffset;       // u32 offsets[stringCount + 1], then the bytes
+    uint64_t stringBytes;
+};
+
+struct ColumnarStore::SessionRecord {
+    uint32_t start;
+    uint32_t end;
+    uint32_t comment;
+    uint32_t firstApplication;
+    uint32_t applicationCount;
+    uint32_t reserved;
+};
+
+struct ColumnarStore::ApplicationRecord {
+    uint32_t processName;
+    uint32_t processPath;
+    uint32_t firstFocus;
+    uint32_t lastFocus;
+    int64_t totalTimeMs;
+    uint32_t firstTab;
+    uint32_t tabCount;
+};
+
+struct ColumnarStore::TabRecord {
+    uint32_t windowTitle;
+    uint32_t reserved;
+    int64_t totalTimeMs;
+};
+
+namespace {
+
+size_t AlignUp(size_t value) {
+    return (value + 7) & ~(size_t)7;
+}
+
+} // namespace
+
+ColumnarStore::ColumnarStore() {
+}
+
+ColumnarStore::~ColumnarStore() {
+    Close();
+}
+
+bool ColumnarStore::Open(const std::string& path) {
+    Close();
+
+    m_file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE, NULL,
+                         OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (m_file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart < (LONGLONG)sizeof(Header)) {
+        Close();
+        return false;
+    }
+    m_size = (size_t)fileSize.QuadPart;
+
+    m_mapping = CreateFileMappingA(m_file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (m_mapping == NULL) {
+        Close();
+        return false;
+    }
+
+    m_base = (const uint8_t*)MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+    if (!m_base || !Validate()) {
+        Close();
+        return false;
+    }
+    return true;
+}
+
+void ColumnarStore::Close() {
+    if (m_base) {
+        UnmapViewOfFile(m_base);
+        m_base = nullptr;
+    }
+    if (m_mapping) {
+        CloseHandle(m_mapping);
+        m_mapping = NULL;
+    }
+    if (m_file != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_file);
+        m_file = INVALID_HANDLE_VALUE;
+    }
+    m_size = 0;
+    m_header = nullptr;
+    m_sessions = nullptr;
+    m_applications = nullptr;
+    m_tabs = nullptr;
+    m_stringOffsets = nullptr;
+    m_stringData = nullptr;
+}
+
+bool ColumnarStore::Validate() {
+    m_header = (const Header*)m_base;
+    const Header& h = *m_header;
+    if (std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0 || h.version != VERSION) {
+        return false;
+    }
+
+    // Every section must lie inside the file
+    auto fits = [this](uint64_t offset, uint64_t count, size_t elementSize) {
+        return offset % 8 == 0 && offset <= m_size && count <= (m_size - offset) / elementSize;
+    };
+    if (!fits(h.sessionsOffset, h.sessionCount, sizeof(SessionRecord)) ||
+        !fits(h.applicationsOffset, h.applicationCount, sizeof(ApplicationRecord)) ||
+        !fits(h.tabsOffset, h.tabCount, sizeof(TabRecord)) ||
+        !fits(h.stringsOffset, (uint64_t)h.stringCount + 1, sizeof(uint32_t))) {
+        return false;
+    }
+    uint64_t stringDataOffset = h.stringsOffset + ((uint64_t)h.stringCount + 1) * sizeof(uint32_t);
+    if (h.stringBytes > m_size - stringDataOffset) {
+        return false;
+    }
+
+    m_sessions = (const SessionRecord*)(m_base + h.sessionsOffset);
+    m_applications = (const ApplicationRecord*)(m_base + h.applicationsOffset);
+    m_tabs = (const TabRecord*)(m_base + h.tabsOffset);
+    m_stringOffsets = (const uint32_t*)(m_base + h.stringsOffset);
+    m_stringData = (const char*)(m_base + stringDataOffset);
+    return true;
+}
+
+ColumnarStore::SourceTag ColumnarStore::GetSourceTag() const {
+    SourceTag tag;
+    if (m_header) {
+        tag.size = m_header->sourceSize;
+        tag.lastWriteTime = m_header->sourceWriteTime;
+        tag.contentHash = m_header->sourceContentHash;
+    }
+    return tag;
+}
+
+size_t ColumnarStore::GetSessionCount() const {
+    return m_header ? m_header->sessionCount : 0;
+}
+
+ColumnarStore::SessionView ColumnarStore::GetSession(size_t index) const {
+    return SessionView(this, (uint32_t)index);
+}
+
+std::string_view ColumnarStore::GetString(uint32_t id) const {
+    if (id >= m_header->stringCount) {
+        return std::string_view();
+    }
+    uint32_t begin = m_stringOffsets[id];
+    uint32_t end = m_stringOffsets[id + 1];
+    if (begin > end || end > m_header->stringBytes) {
+        return std::string_view();  // Corrupt offsets; never read outside the mapping
+    }
+    return std::string_view(m_stringData + begin, end - begin);
+}
+
+long long ColumnarStore::GetTimestamp(uint32_t delta) const {
+    return m_header->baseTimestamp + delta;
+}
+
+// SessionView
+
+long long ColumnarStore::SessionView::GetStartTimestamp() const {
+    return m_store->GetTimestamp(m_store->m_sessions[m_index].start);
+}
+
+long long ColumnarStore::SessionView::GetEndTimestamp() const {
+    return m_store->GetTimestamp(m_store->m_sessions[m_index].end);
+}
+
+std::string_view ColumnarStore::SessionView::GetComment() const {
+    return m_store->GetString(m_store->m_sessions[m_index].comment);
+}
+
+size_t ColumnarStore::SessionView::GetApplicationCount() const {
+    const SessionRecord& record = m_store->m_sessions[m_index];
+    if ((uint64_t)record.firstApplication + record.applicationCount > m_store->m_header->applicationCount) {
+        return 0;
+    }
+    return record.applicationCount;
+}
+
+ColumnarStore::ApplicationView ColumnarStore::SessionView::GetApplication(size_t index) const {
+    return ApplicationView(m_store, m_store->m_sessions[m_index].firstApplication + (uint32_t)index);
+}
+
+// ApplicationView
+
+std::string_view ColumnarStore::ApplicationView::GetProcessName() const {
+    return m_store->GetString(m_store->m_applications[m_index].processName);
+}
+
+std::string_view ColumnarStore::ApplicationView::GetProcessPath() const {
+    return m_store->GetString(m_store->m_applications[m_index].processPath);
+}
+
+long long ColumnarStore::ApplicationView::GetFirstFocusTime() const {
+    return m_store->GetTimestamp(m_store->m_applications[m_index].firstFocus);
+}
+
+long long ColumnarStore::ApplicationView::GetLastFocusTime() const {
+    return m_store->GetTimestamp(m_store->m_applications[m_index].lastFocus);
+}
+
+long long ColumnarStore::ApplicationView::GetTotalTimeMs() const {
+    return m_store->m_applications[m_index].totalTimeMs;
+}
+
+size_t ColumnarStore::ApplicationView::GetTabCount() const {
+    const ApplicationRecord& record = m_store->m_applications[m_index];
+    if ((uint64_t)record.firstTab + record.tabCount > m_store->m_header->tabCount) {
+        return 0;
+    }
+    return record.tabCount;
+}
+
+ColumnarStore::TabView ColumnarStore::ApplicationView::GetTab(size_t index) const {
+    return TabView(m_store, m_store->m_applications[m_index].firstTab + (uint32_t)index);
+}
+
+// TabView
+
+std::string_view ColumnarStore::TabView::GetWindowTitle() const {
+    return m_store->GetString(m_store->m_tabs[m_index].windowTitle);
+}
+
+long long ColumnarStore::TabView::GetTotalTimeMs() const {
+    return m_store->m_tabs[m_index].totalTimeMs;
+}
+
+Session ColumnarStore::Materialize(size_t index) const {
+    SessionView view = GetSession(index);
+
+    Session session;
+    session.start_timestamp = view.GetStartTimestamp();
+    session.end_timestamp = view.GetEndTimestamp();
+    session.comment = std::string(view.GetComment());
+
+    size_t appCount = view.GetApplicationCount();
+    session.applications.reserve(appCount);
+    for (size_t a = 0; a < appCount; a++) {
+        ApplicationView appView = view.GetApplication(a);
+        ApplicationFocusEvent app;
+        app.process_name = std::string(appView.GetProcessName());
+        app.process_path = std::string(appView.GetProcessPath());
+        app.first_focus_time = appView.GetFirstFocusTime();
+        app.last_focus_time = appView.GetLastFocusTime();
+        app.total_time_spent_ms = appView.GetTotalTimeMs();
+
+        size_t tabCount = appView.GetTabCount();
+        app.tabs.reserve(tabCount);
+        for (size_t t = 0; t < tabCount; t++) {
+            TabView tabView = appView.GetTab(t);
+            app.tabs.push_back(TabInfo{ std::string(tabView.GetWindowTitle()), tabView.GetTotalTimeMs() });
+        }
+        session.applications.push_back(std::move(app));
+    }
+    return session;
+}
+
+bool ColumnarStore::Write(const std::string& path, const std::vector<Session>& sessions, const SourceTag& tag) {
+    // Frame of reference for the u32 timestamp deltas
+    long long base = std::numeric_limits<long long>::max();
+    long long top = std::numeric_limits<long long>::min();
+    auto extend = [&](long long ts) {
+        if (ts < base) base = ts;
+        if (ts > top) top = ts;
+    };
+    for (const auto& session : sessions) {
+        extend(session.start_timestamp);
+        extend(session.end_timestamp);
+        for (const auto& app : session.applications) {
+            extend(app.first_focus_time);
+            extend(app.last_focus_time);
+        }
+    }
+    if (sessions.empty()) {
+        base = top = 0;
+    }
+    if (top - base > (long long)std::numeric_limits<uint32_t>::max()) {
+        return false;  // Out of range for this format; callers keep using the JSON
+    }
+
+    StringInterner strings;
+    std::vector<SessionRecord> sessionRecords;
+    std::vector<ApplicationRecord> applicationRecords;
+    std::vector<TabRecord> tabRecords;
+    sessionRecords.reserve(sessions.size());
+
+    for (const auto& session : sessions) {
+        SessionRecord record = {};
+        record.start = (uint32_t)(session.start_timestamp - base);
+        record.end = (uint32_t)(session.end_timestamp - base);
+        record.comment = strings.Intern(session.comment);
+        record.firstApplication = (uint32_t)applicationRecords.size();
+        record.applicationCount = (uint32_t)session.applications.size();
+        sessionRecords.push_back(record);
+
+        for (const auto& app : session.applications) {
+            ApplicationRecord appRecord = {};
+            appRecord.processName = strings.Intern(app.process_name);
+            appRecord.processPath = strings.Intern(app.process_path);
+            appRecord.firstFocus = (uint32_t)(app.first_focus_time - base);
+            appRecord.lastFocus = (uint32_t)(app.last_focus_time - base);
+            appRecord.totalTimeMs = app.total_time_spent_ms;
+            appRecord.firstTab = (uint32_t)tabRecords.size();
+            appRecord.tabCount = (uint32_t)app.tabs.size();
+            applicationRecords.push_back(appRecord);
+
+            for (const auto& tab : app.tabs) {
+                TabRecord tabRecord = {};
+                tabRecord.windowTitle = strings.Intern(tab.window_title);
+                tabRecord.totalTimeMs = tab.total_time_spent_ms;
+                tabRecords.push_back(tabRecord);
+            }
+        }
+    }
+
+    std::vector<uint32_t> stringOffsets;
+    stringOffsets.reserve(strings.Size() + 1);
+    uint64_t stringBytes = 0;
+    for (uint32_t id = 0; id < strings.Size(); id++) {
+        stringOffsets.push_back((uint32_t)stringBytes);
+        stringBytes += strings.Get(id).size();
+    }
+    stringOffsets.push_back((uint32_t)stringBytes);
+    if (stringBytes > std::numeric_limits<uint32_t>::max()) {
+        return false;
+    }
+
+    Header header = {};
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.sourceSize = tag.size;
+    header.sourceWriteTime = tag.lastWriteTime;
+    header.sourceContentHash = tag.contentHash;
+    header.baseTimestamp = base;
+    header.sessionCount = (uint32_t)sessionRecords.size();
+    header.applicationCount = (uint32_t)applicationRecords.size();
+    header.tabCount = (uint32_t)tabRecords.size();
+    header.stringCount = (uint32_t)strings.Size();
+    header.sessionsOffset = AlignUp(sizeof(Header));
+    header.applicationsOffset = AlignUp(header.sessionsOffset + sessionRecords.size() * sizeof(SessionRecord));
+    header.tabsOffset = AlignUp(header.applicationsOffset + applicationRecords.size() * sizeof(ApplicationRecord));
+    header.stringsOffset = AlignUp(header.tabsOffset + tabRecords.size() * sizeof(TabRecord));
+    header.stringBytes = stringBytes;
+
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream outFile(tempPath, std::ios::binary);
+        if (!outFile.is_open()) {
+            return false;
+        }
+
+        auto writeAt = [&outFile](uint64_t offset, const void* data, size_t bytes) {
+            static const char padding[8] = {};
+            size_t position = (size_t)outFile.tellp();
+            if (offset > position) outFile.write(padding, (std::streamsize)(offset - position));
+            if (bytes > 0) outFile.write((const char*)data, (std::streamsize)bytes);
+        };
+        writeAt(0, &header, sizeof(header));
+        writeAt(header.sessionsOffset, sessionRecords.data(), sessionRecords.size() * sizeof(SessionRecord));
+        writeAt(header.applicationsOffset, applicationRecords.data(), applicationRecords.size() * sizeof(ApplicationRecord));
+        writeAt(header.tabsOffset, tabRecords.data(), tabRecords.size() * sizeof(TabRecord));
+        writeAt(header.stringsOffset, stringOffsets.data(), stringOffsets.size() * sizeof(uint32_t));
+        for (uint32_t id = 0; id < strings.Size(); id++) {
+            std::string_view s = strings.Get(id);
+            outFile.write(s.data(), (std::streamsize)s.size());
+        }
+        if (!outFile.good()) {
+            outFile.close();
+            DeleteFileA(tempPath.c_str());
+            return false;
+        }
+    }
+
+    if (!MoveFileExA(tempPath.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        DeleteFileA(tempPath.c_str());
+        return false;
+    }
+    return true;
+}
+
+bool ColumnarStore::GetFileTag(const std::string& path, SourceTag& tag) {
+    WIN32_FILE_ATTRIBUTE_DATA attributes;
+    if (!GetFileAttributesExA(path.c_str(), GetFileExInfoStandard, &attributes)) {
+        return false;
+    }
+    tag.size = ((uint64_t)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+    tag.lastWriteTime = ((uint64_t)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+    tag.contentHash = 0;
+    return true;
+}
+
+bool ColumnarStore::GetContentTag(const std::string& path, SourceTag& tag) {
+    if (!GetFileTag(path, tag)) {
+        return false;
+    }
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    // Head and tail catch appends, rewrites of the last session and
+    // truncation, without reading the whole (possibly huge) file
+    std::string sample;
+    if (tag.size <= 2 * HASH_SAMPLE_SIZE) {
+        sample.resize((size_t)tag.size);
+        file.read(&sample[0], sample.size());
+    } else {
+        sample.resize(2 * HASH_SAMPLE_SIZE);
+        file.read(&sample[0], HASH_SAMPLE_SIZE);
+        file.seekg((std::streamoff)(tag.size - HASH_SAMPLE_SIZE), std::ios::beg);
+        file.read(&sample[HASH_SAMPLE_SIZE], HASH_SAMPLE_SIZE);
+    }
+    if (!file) {
+        return false;
+    }
+    sample.append((const char*)&tag.size, sizeof(tag.size));
+    tag.contentHash = HashBytes(sample.data(), sample.size());
+    return true;
+}
+
+} // namespace viewer
+} // namespace bigbrother
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <windows.h>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "session_data.h"
+
+namespace bigbrother {
+namespace viewer {
+
+/**
+ * @brief Read-optimized binary copy of a session file, read through a memory mapping
+ *
+ * Layout (all little-endian, every section 8-byte aligned):
+ *   Header
+ *   SessionRecord[sessionCount]
+ *   ApplicationRecord[applicationCount]   (grouped by session)
+ *   TabRecord[tabCount]                   (grouped by application)
+ *   u32 stringOffsets[stringCount + 1], then the string bytes
+ *
+ * Strings (comments, names, paths, titles) are stored once in the shared
+ * table and referenced by index. Timestamps are u32 deltas from the file's
+ * base timestamp, so records stay fixed-width and randomly addressable.
+ *
+ * Opening a store maps the file and checks the header and section bounds.
+ * Nothing else is read up front: the views below decode fields straight from
+ * the mapping, so only the pages that are actually accessed become resident.
+ */
+class ColumnarStore {
+public:
+    static constexpr char MAGIC[4] = { 'B', 'B', 'C', 'S' };
+    static constexpr uint32_t VERSION = 2;
+
+    /** @brief Bytes hashed at each end of the source for SourceTag::contentHash */
+    static constexpr size_t HASH_SAMPLE_SIZE = 64 * 1024;
+
+    /**
+     * @brief Identity of the JSON file a store was built from
+     */
+    struct SourceTag {
+        uint64_t size = 0;
+        uint64_t lastWriteTime = 0;  ///< FILETIME as a 64-bit value
+        uint64_t contentHash = 0;    ///< Sampled hash (GetContentTag); 0 from GetFileTag
+
+        bool operator==(const SourceTag& other) const {
+            return size == other.size && lastWriteTime == other.lastWriteTime && contentHash == other.contentHash;
+        }
+    };
+
+    class ApplicationView;
+    class TabView;
+
+    /**
+     * @brief Zero-copy view of one session
+     */
+    class SessionView {
+    public:
+        long long GetStartTimestamp() const;
+        long long GetEndTimestamp() const;
+        std::string_view GetComment() const;
+        size_t GetApplicationCount() const;
+        ApplicationView GetApplication(size_t index) const;
+
+    private:
+        friend class ColumnarStore;
+        SessionView(const ColumnarStore* store, uint32_t index) : m_store(store), m_index(index) {}
+        const ColumnarStore* m_store;
+        uint32_t m_index;
+    };
+
+    /**
+     * @brief Zero-copy view of one application within a session
+     */
+    class ApplicationView {
+    public:
+        std::string_view GetProcessName() const;
+        std::string_view GetProcessPath() const;
+        long long GetFirstFocusTime() const;
+        long long GetLastFocusTime() const;
+        long long GetTotalTimeMs() const;
+        size_t GetTabCount() const;
+        TabView GetTab(size_t index) const;
+
+    private:
+        friend class ColumnarStore;
+        ApplicationView(const ColumnarStore* store, uint32_t index) : m_store(store), m_index(index) {}
+        const ColumnarStore* m_store;
+        uint32_t m_index;
+    };
+
+    /**
+     * @brief Zero-copy view of one tab within an application
+     */
+    class TabView {
+    public:
+        std::string_view GetWindowTitle() const;
+        long long GetTotalTimeMs() const;
+
+    private:
+        friend class ColumnarStore;
+        TabView(const ColumnarStore* store, uint32_t index) : m_store(store), m_index(index) {}
+        const ColumnarStore* m_store;
+        uint32_t m_index;
+    };
+
+    ColumnarStore();
+    ~ColumnarStore();
+    ColumnarStore(const ColumnarStore&) = delete;
+    ColumnarStore& operator=(const ColumnarStore&) = delete;
+
+    /**
+     * @brief Map a store file and validate its layout
+     * @param path Store file
+     * @return true if the file is a well-formed store
+     */
+    bool Open(const std::string& path);
+
+    /**
+     * @brief Unmap the file; views obtained earlier become invalid
+     */
+    void Close();
+
+    bool IsOpen() const { return m_base != nullptr; }
+
+    /**
+     * @brief Tag of the source file this store was built from
+     */
+    SourceTag GetSourceTag() const;
+
+    size_t GetSessionCount() const;
+    SessionView GetSession(size_t index) const;
+
+    /**
+     * @brief Copy one session out of the mapping into owning structures
+     */
+    Session Materialize(size_t index) const;
+
+    /**
+     * @brief Write `sessions` as a store file (temp file + rename)
+     * @param path Destination store file
+     * @param sessions Sessions to store, in order
+     * @param tag Identity of the JSON file they came from
+     * @return true if written successfully
+     */
+    static bool Write(const std::string& path, const std::vector<Session>& sessions, const SourceTag& tag);
+
+    /**
+     * @brief Current size and write time of a file on disk (no content hash)
+     * @return false if the file does not exist
+     */
+    static bool GetFileTag(const std::string& path, SourceTag& tag);
+
+    /**
+     * @brief GetFileTag plus a hash of the file's first and last
+     *        HASH_SAMPLE_SIZE bytes, for sources that may have been rewritten
+     *        in place, where metadata alone is not trusted
+     * @return false if the file does not exist or cannot be read
+     */
+    static bool GetContentTag(const std::string& path, SourceTag& tag);
+
+private:
+    struct Header;
+    struct SessionRecord;
+    struct ApplicationRecord;
+    struct TabRecord;
+
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = NULL;
+    const uint8_t* m_base = nullptr;
+    size_t m_size = 0;
+
+    // Section pointers into the mapping
+    const Header* m_header = nullptr;
+    const SessionRecord* m_sessions = nullptr;
+    const ApplicationRecord* m_applications = nullptr;
+    const TabRecord* m_tabs = nullptr;
+    const uint32_t* m_stringOffsets = nullptr;
+    const char* m_stringData = nullptr;
+
+    bool Validate();
+    std::string_view GetString(uint32_t id) const;
+    long long GetTimestamp(uint32_t delta) const;
+};
+
+} // namespace viewer
+} // namespace bigbrother
@@ -58,6 +58,8 @@ bool FilterManager::IsFiltered(const std::string& programName) const {
 }
 
 void FilterManager::SaveSettings() {
+    m_version++;
+    
     json settings;
     settings["program_filters"] = json::array();
     
@@ -77,6 +79,8 @@ void FilterManager::SaveSettings() {
 }
 
 void FilterManager::LoadSettings() {
+    m_version++;
+    
     std::string settingsPath = GetSettingsFilePath();
     std::ifstream inFile(settingsPath);
     
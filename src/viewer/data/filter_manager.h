@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstdint>
 #include <string>
 #include <vector>
 
@@ -62,6 +63,14 @@ public:
      */
     std::vector<ProgramFilter>& GetFilters() { return m_filters; }
 
+    /**
+     * @brief Changes whenever the filter list is saved or loaded
+     * 
+     * Every edit ends in SaveSettings, so views can compare this instead of
+     * the list itself to know when to re-apply filters.
+     */
+    uint64_t GetVersion() const { return m_version; }
+
     /**
      * @brief Save filters to settings file
      */
@@ -74,6 +83,7 @@ public:
 
 private:
     std::vector<ProgramFilter> m_filters;
+    uint64_t m_version = 0;
     std::string GetSettingsFilePath() const;
 };
 
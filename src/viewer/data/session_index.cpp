@@ -0,0 +1,83 @@
+#include "session_index.h"
+#include <algorithm>
+
+namespace bigbrother {
+namespace viewer {
+
+SessionHeader SessionHeader::FromSession(Session session) {
+    SessionHeader header;
+    header.start_timestamp = session.start_timestamp;
+    header.end_timestamp = session.end_timestamp;
+    header.comment = session.comment;
+    header.application_count = (uint32_t)session.applications.size();
+    for (const auto& app : session.applications) {
+        header.tab_count += (uint32_t)app.tabs.size();
+    }
+    SortTabsByTime(session);
+    header.details = std::make_shared<const Session>(std::move(session));
+    return header;
+}
+
+SessionHeader SessionHeader::FromStore(const std::shared_ptr<const ColumnarStore>& store, uint32_t index) {
+    ColumnarStore::SessionView view = store->GetSession(index);
+
+    SessionHeader header;
+    header.start_timestamp = view.GetStartTimestamp();
+    header.end_timestamp = view.GetEndTimestamp();
+    header.comment = std::string(view.GetComment());
+    header.application_count = (uint32_t)view.GetApplicationCount();
+    for (size_t i = 0; i < view.GetApplicationCount(); i++) {
+        header.tab_count += (uint32_t)view.GetApplication(i).GetTabCount();
+    }
+    header.store = store;
+    header.store_index = index;
+    return header;
+}
+
+void SortTabsByTime(Session& session) {
+    for (auto& app : session.applications) {
+        std::stable_sort(app.tabs.begin(), app.tabs.end(), [](const TabInfo& a, const TabInfo& b) {
+            return a.total_time_spent_ms > b.total_time_spent_ms;
+        });
+    }
+}
+
+SessionDetailCache::SessionDetailCache(size_t capacity)
+    : m_capacity(capacity > 0 ? capacity : 1) {
+}
+
+std::shared_ptr<const Session> SessionDetailCache::Get(const SessionHeader& header) {
+    if (header.details) {
+        return header.details;
+    }
+    if (!header.store) {
+        return std::make_shared<const Session>();
+    }
+
+    Key key{ header.store.get(), header.store_index };
+    auto it = m_lookup.find(key);
+    if (it != m_lookup.end()) {
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return it->second->session;
+    }
+
+    // Miss: decode from the mapping and evict the least recently used
+    Session decoded = header.store->Materialize(header.store_index);
+    SortTabsByTime(decoded);
+    auto session = std::make_shared<const Session>(std::move(decoded));
+    m_entries.push_front({ key, header.store, session });
+    m_lookup[key] = m_entries.begin();
+    while (m_entries.size() > m_capacity) {
+        m_lookup.erase(m_entries.back().key);
+        m_entries.pop_back();
+    }
+    return session;
+}
+
+void SessionDetailCache::Clear() {
+    m_lookup.clear();
+    m_entries.clear();
+}
+
+} // namespace viewer
+} // namespace bigbrother
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include "session_data.h"
+#include "columnar_store.h"
+
+namespace bigbrother {
+namespace viewer {
+
+/**
+ * @brief What the timeline needs to list a session without its details
+ *
+ * Sessions from sealed files only carry the header plus the location of the
+ * session in that file's ColumnarStore; their applications and tabs are
+ * decoded on demand through SessionDetailCache. Sessions that are still
+ * changing (today's segment, the journal) come with their details decoded.
+ */
+struct SessionHeader {
+    long long start_timestamp = 0;
+    long long end_timestamp = 0;
+    std::string comment;
+    uint32_t application_count = 0;
+    uint32_t tab_count = 0;
+
+    std::shared_ptr<const Session> details;        ///< Set for decoded sessions
+    std::shared_ptr<const ColumnarStore> store;    ///< Otherwise, where to decode from
+    uint32_t store_index = 0;
+
+    bool IsDecoded() const { return details != nullptr; }
+
+    /**
+     * @brief Header for an already decoded session
+     */
+    static SessionHeader FromSession(Session session);
+
+    /**
+     * @brief Header for session `index` of an open store (details not decoded)
+     */
+    static SessionHeader FromStore(const std::shared_ptr<const ColumnarStore>& store, uint32_t index);
+};
+
+/**
+ * @brief Order every application's tabs by time spent, longest first
+ *
+ * Logs store tabs sorted by title. Sessions are put in display order once,
+ * when they are decoded, so the timeline never sorts while drawing. Tabs
+ * with equal time keep their title order.
+ */
+void SortTabsByTime(Session& session);
+
+/**
+ * @brief LRU of decoded session details
+ *
+ * Used from the UI thread only. Holds at most `capacity` sessions, so memory
+ * stays bounded however much history is listed.
+ */
+class SessionDetailCache {
+public:
+    static constexpr size_t DEFAULT_CAPACITY = 256;
+
+    explicit SessionDetailCache(size_t capacity = DEFAULT_CAPACITY);
+
+    /**
+     * @brief Details of a session, decoding them from its store on a miss
+     * @return The session; never null
+     */
+    std::shared_ptr<const Session> Get(const SessionHeader& header);
+
+    void Clear();
+    size_t Size() const { return m_entries.size(); }
+
+private:
+    struct Key {
+        const ColumnarStore* store;
+        uint32_t index;
+
+        bool operator==(const Key& other) const { return store == other.store && index == other.index; }
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const {
+            return std::hash<const void*>()(key.store) ^ ((size_t)key.index * 0x9E3779B97F4A7C15ull);
+        }
+    };
+
+    struct Entry {
+        Key key;
+        std::shared_ptr<const ColumnarStore> store;  // Keeps the key's pointer from being reused
+        std::shared_ptr<const Session> session;
+    };
+
+    size_t m_capacity;
+    std::list<Entry> m_entries;    // Most recently used first
+    std::unordered_map<Key, std::list<Entry>::iterator, KeyHash> m_lookup;
+};
+
+} // namespace viewer
+} // namespace bigbrother
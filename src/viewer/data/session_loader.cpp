@@ -2,9 +2,12 @@
 #include <windows.h>
 #include <shlobj.h>
 #include <fstream>
-#include "json.hpp"
-
-using json = nlohmann::json;
+#include <algorithm>
+#include <iterator>
+#include "event_journal.h"
+#include "columnar_store.h"
+#include "session_parser.h"
+#include "string_interner.h"
 
 namespace bigbrother {
 namespace viewer {
@@ -15,131 +18,363 @@ SessionLoader::SessionLoader() {
 SessionLoader::~SessionLoader() {
 }
 
-std::vector<Session> SessionLoader::LoadFromFile(const std::string& filePath) {
-    std::vector<Session> sessions;
+std::vector<SessionHeader> SessionLoader::LoadFromFile(const std::string& filePath, LoadMode mode) {
+    std::vector<SessionHeader> sessions;
+    InvalidateCache();
+    Refresh(filePath, sessions, mode);
+    return sessions;
+}
+
+void SessionLoader::InvalidateCache() {
+    m_loadedSources.clear();
+    m_loadedFilePath.clear();
+    m_loadedSessionCount = 0;
+    m_journalTag = ColumnarStore::SourceTag();
+    m_activeMerge = ActiveMerge::None;
+    m_settledSessionCount = 0;
+}
+
+std::vector<SessionLoader::Source> SessionLoader::ListSources(const std::string& filePath, LoadMode mode) {
+    // Sources oldest first: the pre-segmentation log, then one file per day.
+    // Everything but today's segment is sealed: the monitor no longer writes
+    // the legacy log, and only ever appends to today's segment.
+    std::vector<Source> sources;
+    if (GetFileAttributesA(filePath.c_str()) != INVALID_FILE_ATTRIBUTES) {
+        sources.push_back({ filePath, true });
+    }
+    std::string today = SegmentStore::GetSegmentFileName(GetUnixTimestamp());
+    for (const auto& segment : m_segments.ListSegments()) {
+        sources.push_back({ m_segments.GetSegmentPath(segment.file), segment.file != today });
+    }
     
-    std::ifstream inFile(filePath);
-    if (!inFile.is_open()) {
-        return sessions; // Return empty vector
+    size_t first = 0;
+    if (mode == LoadMode::Lazy && sources.size() > m_lazySegments) {
+        first = sources.size() - m_lazySegments;
+    }
+    m_unloadedSegments = first;
+    sources.erase(sources.begin(), sources.begin() + first);
+    
+    for (auto& source : sources) {
+        ColumnarStore::GetFileTag(source.path, source.tag);
+    }
+    return sources;
+}
+
+size_t SessionLoader::Refresh(const std::string& filePath, std::vector<SessionHeader>& sessions, LoadMode mode) {
+    m_segments.SetDataFilePath(filePath);
+    std::vector<Source> sources = ListSources(filePath, mode);
+    
+    // The cache only describes `sessions` if nobody else has changed it
+    if (filePath != m_loadedFilePath || sessions.size() != m_loadedSessionCount ||
+        m_activeMerge == ActiveMerge::Replaced) {
+        InvalidateCache();
+        sessions.clear();
+    }
+    size_t firstChanged = sessions.size();
+    
+    // Sources identical to the last load keep their sessions untouched
+    size_t unchanged = 0;
+    size_t keptSessions = 0;
+    while (unchanged < sources.size() && unchanged < m_loadedSources.size()) {
+        const LoadedSource& loaded = m_loadedSources[unchanged];
+        const Source& source = sources[unchanged];
+        if (loaded.path != source.path || loaded.sealed != source.sealed || !(loaded.tag == source.tag)) {
+            break;
+        }
+        keptSessions += loaded.sessionCount;
+        unchanged++;
+    }
+    
+    ColumnarStore::SourceTag journalTag;
+    ColumnarStore::GetFileTag(GetJournalPath(filePath), journalTag);
+    
+    if (unchanged == sources.size() && unchanged == m_loadedSources.size() &&
+        journalTag == m_journalTag && !m_loadedFilePath.empty()) {
+        return firstChanged;
+    }
+    
+    // The active session is re-read from the journal below
+    if (m_activeMerge == ActiveMerge::Appended) {
+        sessions.pop_back();
+    }
+    firstChanged = std::min(firstChanged, keptSessions);
+    
+    uint64_t bytesToRead = 0;
+    for (size_t i = unchanged; i < sources.size(); i++) {
+        bytesToRead += sources[i].tag.size;
+    }
+    m_progress.bytesTotal = bytesToRead;
+    m_progress.bytesDone = 0;
+    
+    // A JSON source that changed keeps its sessions for now, so that only
+    // the part after its unchanged prefix has to be parsed again
+    bool reparseTail = unchanged < sources.size() && unchanged < m_loadedSources.size() &&
+                       !sources[unchanged].sealed && !m_loadedSources[unchanged].sealed &&
+                       m_loadedSources[unchanged].path == sources[unchanged].path;
+    if (reparseTail) {
+        sessions.erase(sessions.begin() + keptSessions + m_loadedSources[unchanged].sessionCount, sessions.end());
+        m_loadedSources.resize(unchanged + 1);
+    } else {
+        sessions.erase(sessions.begin() + keptSessions, sessions.end());
+        m_loadedSources.resize(unchanged);
     }
     
-    try {
-        json data;
-        inFile >> data;
-        inFile.close();
+    for (size_t i = unchanged; i < sources.size(); i++) {
+        if (i == m_loadedSources.size()) {
+            m_loadedSources.emplace_back();
+            m_loadedSources.back().path = sources[i].path;
+            m_loadedSources.back().sealed = sources[i].sealed;
+        }
+        LoadedSource& loaded = m_loadedSources[i];
+        loaded.tag = sources[i].tag;
         
-        if (data.contains("sessions") && data["sessions"].is_array()) {
-            for (const auto& sessionJson : data["sessions"]) {
-                sessions.push_back(ParseSession(sessionJson));
-            }
+        uint64_t bytesBefore = m_progress.bytesDone;
+        size_t first = sessions.size() - loaded.sessionCount;
+        if (loaded.sealed) {
+            LoadSealedSource(loaded.path, loaded.path == filePath, sessions);
+        } else {
+            LoadJsonSource(loaded, sessions);
         }
-    } catch (const json::exception& e) {
-        // Error parsing JSON, return what we have
+        loaded.sessionCount = sessions.size() - first;
+        m_progress.bytesDone = bytesBefore + loaded.tag.size;
     }
     
-    return sessions;
+    // The active session lives in the journal until it is stopped
+    m_journalTag = journalTag;
+    m_activeMerge = MergeActiveSession(filePath, sessions);
+    if (m_activeMerge == ActiveMerge::Replaced) {
+        firstChanged = 0;  // Could be anywhere in the history
+    }
+    
+    // Everything up to today's segment only changes through deletes
+    std::string today = m_segments.GetSegmentPath(SegmentStore::GetSegmentFileName(GetUnixTimestamp()));
+    m_settledSessionCount = 0;
+    for (const auto& loaded : m_loadedSources) {
+        if (loaded.path == today) {
+            break;
+        }
+        m_settledSessionCount += loaded.sessionCount;
+    }
+    
+    m_loadedFilePath = filePath;
+    m_loadedSessionCount = sessions.size();
+    return firstChanged;
 }
 
-std::string SessionLoader::GetDefaultDataPath() const {
-    char path[MAX_PATH];
-    if (SUCCEEDED(SHGetFolderPathA(NULL, CSIDL_APPDATA, NULL, 0, path))) {
-        return std::string(path) + "\\BigBrother\\focus_log.json";
+bool SessionLoader::LoadJsonSource(LoadedSource& source, std::vector<SessionHeader>& sessions) {
+    size_t first = sessions.size() - source.sessionCount;
+    std::string contents;
+    bool read = ReadFileContents(source.path, contents);
+    
+    // Everything but the last known session survives if the bytes before
+    // that session are unchanged (the monitor appends or rewrites the tail)
+    size_t kept = 0;
+    if (read && !source.ranges.empty() && source.ranges.size() == source.sessionCount) {
+        size_t prefix = source.ranges.back().begin;
+        if (contents.size() > prefix && HashBytes(contents.data(), prefix) == source.prefixChecksum) {
+            kept = source.ranges.size() - 1;
+        }
     }
-    return "focus_log.json";
+    sessions.erase(sessions.begin() + first + kept, sessions.end());
+    source.ranges.resize(kept);
+    source.prefixChecksum = 0;
+    if (!read) {
+        return false;
+    }
+    
+    const char* begin = contents.data();
+    const char* end = begin + contents.size();
+    std::vector<SessionParser::Range> tail;
+    std::vector<Session> parsed;
+    bool scanned = kept > 0 ? SessionParser::FindSessionsFrom(begin, end, source.ranges.back().end, tail)
+                            : SessionParser::FindSessions(begin, end, tail);
+    if (!scanned || !SessionParser::ParseSessions(begin, tail, parsed, 0, &m_progress.bytesDone)) {
+        // Not the expected layout, or malformed after the kept prefix (the
+        // scan checks separators and the end of the document): parse it
+        // all, keeping the valid prefix
+        sessions.erase(sessions.begin() + first, sessions.end());
+        source.ranges.clear();
+        parsed.clear();
+        bool complete = SessionParser::ParseDocument(begin, end, parsed);
+        AppendDecoded(parsed, sessions);
+        return complete;
+    }
+    AppendDecoded(parsed, sessions);
+    
+    source.ranges.insert(source.ranges.end(), tail.begin(), tail.end());
+    if (!source.ranges.empty()) {
+        source.prefixChecksum = HashBytes(begin, source.ranges.back().begin);
+    }
+    return true;
 }
 
-Session SessionLoader::ParseSession(const json& sessionJson) {
-    Session session;
-    session.start_timestamp = sessionJson.value("start_timestamp", 0LL);
-    session.end_timestamp = sessionJson.value("end_timestamp", 0LL);
-    session.comment = sessionJson.value("comment", "");
+bool SessionLoader::ReadFileContents(const std::string& path, std::string& contents) {
+    // Read rather than mapped, so the monitor can still replace the file
+    std::ifstream inFile(path, std::ios::binary);
+    if (!inFile.is_open()) {
+        return false;
+    }
+    inFile.seekg(0, std::ios::end);
+    std::streamoff size = inFile.tellg();
+    inFile.seekg(0, std::ios::beg);
+    if (size < 0) {
+        return false;
+    }
     
-    if (sessionJson.contains("applications") && sessionJson["applications"].is_array()) {
-        for (const auto& appJson : sessionJson["applications"]) {
-            session.applications.push_back(ParseApplicationEvent(appJson));
-        }
+    contents.resize((size_t)size);
+    inFile.read(&contents[0], size);
+    contents.resize((size_t)inFile.gcount());
+    return true;
+}
+
+std::string SessionLoader::GetStorePath(const std::string& jsonPath) {
+    const std::string ext = ".json";
+    if (jsonPath.size() >= ext.size() && jsonPath.compare(jsonPath.size() - ext.size(), ext.size(), ext) == 0) {
+        return jsonPath.substr(0, jsonPath.size() - ext.size()) + ".bbcs";
+    }
+    return jsonPath + ".bbcs";
+}
+
+bool SessionLoader::LoadSealedSource(const std::string& path, bool legacy, std::vector<SessionHeader>& sessions) {
+    ColumnarStore::SourceTag tag;
+    if (!(legacy ? ColumnarStore::GetContentTag(path, tag) : ColumnarStore::GetFileTag(path, tag))) {
+        return false;
     }
     
-    return session;
+    // Use the binary copy while its tag still matches
+    std::string storePath = GetStorePath(path);
+    if (AppendFromStore(storePath, &tag, sessions)) {
+        return true;
+    }
+    
+    // Missing or stale: parse the JSON once and rebuild the store. Reading
+    // back from the new store lets the parsed details go right away.
+    std::vector<Session> parsed;
+    bool complete = LoadJsonFile(path, parsed);
+    if (complete && ColumnarStore::Write(storePath, parsed, tag) && AppendFromStore(storePath, &tag, sessions)) {
+        return true;
+    }
+    
+    AppendDecoded(parsed, sessions);
+    return complete;
 }
 
-ApplicationFocusEvent SessionLoader::ParseApplicationEvent(const json& appJson) {
-    ApplicationFocusEvent app;
-    app.process_name = appJson.value("process_name", "");
-    app.process_path = appJson.value("process_path", "");
-    app.first_focus_time = appJson.value("first_focus_time", 0LL);
-    app.last_focus_time = appJson.value("last_focus_time", 0LL);
-    app.total_time_spent_ms = appJson.value("total_time_spent_ms", 0LL);
+bool SessionLoader::AppendFromStore(const std::string& storePath, const ColumnarStore::SourceTag* tag,
+                                    std::vector<SessionHeader>& sessions) {
+    auto store = std::make_shared<ColumnarStore>();
+    if (!store->Open(storePath) || (tag && !(store->GetSourceTag() == *tag))) {
+        return false;
+    }
     
-    if (appJson.contains("tabs") && appJson["tabs"].is_array()) {
-        for (const auto& tabJson : appJson["tabs"]) {
-            TabInfo tab;
-            tab.window_title = tabJson.value("window_title", "");
-            tab.total_time_spent_ms = tabJson.value("total_time_spent_ms", 0LL);
-            app.tabs.push_back(tab);
-        }
+    // Only headers are read here; details are decoded when a session is expanded
+    std::shared_ptr<const ColumnarStore> shared = std::move(store);
+    size_t count = shared->GetSessionCount();
+    sessions.reserve(sessions.size() + count);
+    for (size_t i = 0; i < count; i++) {
+        sessions.push_back(SessionHeader::FromStore(shared, (uint32_t)i));
     }
+    return true;
+}
+
+void SessionLoader::AppendDecoded(std::vector<Session>& parsed, std::vector<SessionHeader>& sessions) {
+    sessions.reserve(sessions.size() + parsed.size());
+    for (auto& session : parsed) {
+        sessions.push_back(SessionHeader::FromSession(std::move(session)));
+    }
+    parsed.clear();
+}
+
+bool SessionLoader::LoadJsonFile(const std::string& path, std::vector<Session>& sessions) {
+    // The structural decoder works on the whole file in memory
+    std::string contents;
+    if (!ReadFileContents(path, contents)) {
+        return false;
+    }
+    const char* begin = contents.data();
+    const char* end = begin + contents.size();
     
-    return app;
+    if (contents.size() < PARALLEL_MIN_BYTES) {
+        // Sessions complete before a parse error are kept
+        return SessionParser::ParseDocument(begin, end, sessions);
+    }
+    
+    // Large file: split it into sessions and parse them on all cores
+    return SessionParser::ParseDocumentParallel(begin, end, sessions, 0, &m_progress.bytesDone);
 }
 
-bool SessionLoader::SaveToFile(const std::string& filePath, const std::vector<Session>& sessions) {
-    try {
-        json data;
-        data["sessions"] = json::array();
-        
-        // Convert sessions to JSON
-        for (const auto& session : sessions) {
-            json sessionJson;
-            sessionJson["start_timestamp"] = session.start_timestamp;
-            sessionJson["end_timestamp"] = session.end_timestamp;
-            sessionJson["comment"] = session.comment;
-            sessionJson["applications"] = json::array();
-            
-            // Convert application events
-            for (const auto& app : session.applications) {
-                json appJson;
-                appJson["process_name"] = app.process_name;
-                appJson["process_path"] = app.process_path;
-                appJson["first_focus_time"] = app.first_focus_time;
-                appJson["last_focus_time"] = app.last_focus_time;
-                appJson["total_time_spent_ms"] = app.total_time_spent_ms;
-                appJson["tabs"] = json::array();
-                
-                // Convert tabs
-                for (const auto& tab : app.tabs) {
-                    json tabJson;
-                    tabJson["window_title"] = tab.window_title;
-                    tabJson["total_time_spent_ms"] = tab.total_time_spent_ms;
-                    appJson["tabs"].push_back(tabJson);
-                }
-                
-                sessionJson["applications"].push_back(appJson);
-            }
-            
-            data["sessions"].push_back(sessionJson);
-        }
-        
-        // Write to file
-        std::ofstream outFile(filePath);
-        if (!outFile.is_open()) {
-            return false;
+SessionLoader::ActiveMerge SessionLoader::MergeActiveSession(const std::string& filePath,
+                                                             std::vector<SessionHeader>& sessions) {
+    Session active;
+    if (!JournalReader::ReplayFile(GetJournalPath(filePath), active)) {
+        return ActiveMerge::None;
+    }
+    
+    // Replace a copy already written to the history (e.g. interrupted recovery)
+    for (auto& session : sessions) {
+        if (session.start_timestamp == active.start_timestamp) {
+            session = SessionHeader::FromSession(std::move(active));
+            return ActiveMerge::Replaced;
         }
-        
-        outFile << data.dump(2); // Pretty print with 2-space indent
-        outFile.close();
-        return true;
-    } catch (const json::exception& e) {
-        return false;
     }
+    sessions.push_back(SessionHeader::FromSession(std::move(active)));
+    return ActiveMerge::Appended;
+}
+
+std::string SessionLoader::GetDefaultDataPath() const {
+    char path[MAX_PATH];
+    if (SUCCEEDED(SHGetFolderPathA(NULL, CSIDL_APPDATA, NULL, 0, path))) {
+        return std::string(path) + "\\BigBrother\\focus_log.json";
+    }
+    return "focus_log.json";
+}
+
+bool SessionLoader::SaveToFile(const std::string& filePath, const std::vector<Session>& sessions, JsonStyle style) {
+    // Streamed straight from the Session structs; no json tree is built
+    return WriteSessionsFile(filePath, sessions, style);
 }
 
-bool SessionLoader::DeleteSession(std::vector<Session>& sessions, int sessionIndex) {
+bool SessionLoader::DeleteSession(const std::string& filePath, std::vector<SessionHeader>& sessions, int sessionIndex) {
     if (sessionIndex < 0 || sessionIndex >= sessions.size()) {
         return false;
     }
     
+    long long startTimestamp = sessions[sessionIndex].start_timestamp;
+    m_segments.SetDataFilePath(filePath);
+    
+    std::string rewrittenPath = m_segments.GetSegmentPath(SegmentStore::GetSegmentFileName(startTimestamp));
+    bool deleted = m_segments.DeleteSession(startTimestamp);
+    if (!deleted) {
+        // Recorded before segmentation
+        SegmentInfo summary;
+        bool found = false;
+        rewrittenPath = filePath;
+        deleted = SegmentStore::RewriteSessionFile(filePath, startTimestamp, nullptr, JsonStyle::Compact, summary, found) && found;
+    }
+    if (!deleted) {
+        return false;
+    }
+    
+    // Only that file changed; drop its binary copy rather than leave it stale
+    DeleteFileA(GetStorePath(rewrittenPath).c_str());
+    
+    // Sources before that file keep their sessions; the next Refresh reads it
+    // and everything after it again
+    size_t keptSources = 0;
+    size_t keptSessions = 0;
+    while (keptSources < m_loadedSources.size() && m_loadedSources[keptSources].path != rewrittenPath) {
+        keptSessions += m_loadedSources[keptSources].sessionCount;
+        keptSources++;
+    }
+    bool cached = m_loadedSessionCount == sessions.size() && m_activeMerge != ActiveMerge::Replaced &&
+                  keptSources < m_loadedSources.size() && (size_t)sessionIndex >= keptSessions;
+    
     sessions.erase(sessions.begin() + sessionIndex);
+    if (cached) {
+        m_loadedSources.resize(keptSources);
+        m_loadedSessionCount = sessions.size();
+    } else {
+        InvalidateCache();
+    }
     return true;
 }
 
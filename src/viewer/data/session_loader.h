@@ -1,27 +1,108 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
 #include <string>
 #include <vector>
 #include "session_data.h"
-#include "json.hpp"
+#include "session_writer.h"
+#include "segment_store.h"
+#include "columnar_store.h"
+#include "session_parser.h"
+#include "session_index.h"
 
 namespace bigbrother {
 namespace viewer {
 
+/**
+ * @brief How much history LoadFromFile reads
+ */
+enum class LoadMode {
+    Full,   ///< Legacy focus_log.json plus every history segment
+    Lazy    ///< Only the newest segments (see ExtendLazyWindow)
+};
+
+/**
+ * @brief How far the current load has got, readable from other threads
+ */
+struct LoadProgress {
+    std::atomic<uint64_t> bytesTotal{ 0 };  ///< Size of the files being read
+    std::atomic<uint64_t> bytesDone{ 0 };
+};
+
 /**
  * @brief Loads and parses session data from JSON files
+ * 
+ * History is read from the per-day segments listed in history\manifest.json,
+ * preceded by the pre-segmentation focus_log.json if one exists.
+ * 
+ * The loader remembers what it read from each file, so Refresh only reads
+ * what changed since the previous load.
  */
 class SessionLoader {
 public:
+    static constexpr size_t DEFAULT_LAZY_SEGMENTS = 7;
+    static constexpr size_t PARALLEL_MIN_BYTES = 4 << 20;  ///< Smaller files are parsed on one thread
+
     SessionLoader();
     ~SessionLoader();
 
     /**
-     * @brief Load sessions from JSON file
+     * @brief Load sessions from the history segments and the legacy file
+     * 
+     * Also replays the active session's journal (focus_log.journal) so a
+     * session that is still recording shows up alongside the history.
+     * 
+     * @param filePath Path to focus_log.json (segments live next to it)
+     * @param mode Full loads all history; Lazy reads the manifest and only
+     *             opens the newest segments
+     * @return Session headers, oldest first. Sessions from sealed files are
+     *         backed by their ColumnarStore and decoded on demand (see
+     *         SessionDetailCache); the others come decoded.
+     */
+    std::vector<SessionHeader> LoadFromFile(const std::string& filePath, LoadMode mode = LoadMode::Full);
+
+    /**
+     * @brief Bring sessions from an earlier load up to date, in place
+     * 
+     * Files whose size and write time are unchanged are not read. A changed
+     * JSON file whose bytes before its last known session still match their
+     * checksum only has that tail parsed again, and the journal is replayed
+     * only when it changed. Anything else falls back to a full load.
+     * 
      * @param filePath Path to focus_log.json
-     * @return Vector of parsed sessions
+     * @param sessions Result of the previous LoadFromFile/Refresh, unmodified
+     * @param mode Full or Lazy, as for LoadFromFile
+     * @return Index of the first session that may have changed
+     *         (sessions.size() if none did)
+     */
+    size_t Refresh(const std::string& filePath, std::vector<SessionHeader>& sessions, LoadMode mode = LoadMode::Full);
+
+    /**
+     * @brief Number of leading sessions that come from files the monitor no
+     *        longer writes (everything before today's segment)
+     */
+    size_t GetSettledSessionCount() const { return m_settledSessionCount; }
+
+    /**
+     * @brief Progress of the load in flight; may be polled from any thread
+     */
+    const LoadProgress& GetProgress() const { return m_progress; }
+
+    /**
+     * @brief Forget what was loaded; the next Refresh reads everything again
+     */
+    void InvalidateCache();
+
+    /**
+     * @brief Include `segments` more (older) segments in subsequent lazy loads
+     */
+    void ExtendLazyWindow(size_t segments) { m_lazySegments += segments; }
+
+    /**
+     * @brief Number of history sources the last lazy load skipped
      */
-    std::vector<Session> LoadFromFile(const std::string& filePath);
+    size_t GetUnloadedSegmentCount() const { return m_unloadedSegments; }
 
     /**
      * @brief Get default data file path
@@ -33,24 +114,93 @@ public:
      * @brief Save sessions to JSON file
      * @param filePath Path to focus_log.json
      * @param sessions Vector of sessions to save
+     * @param style Compact (default) or 2-space indented output
      * @return true if saved successfully
      */
-    bool SaveToFile(const std::string& filePath, const std::vector<Session>& sessions);
+    bool SaveToFile(const std::string& filePath, const std::vector<Session>& sessions,
+                    JsonStyle style = JsonStyle::Compact);
 
     /**
-     * @brief Delete a session by index
-     * @param sessions Vector of sessions
+     * @brief Delete a session by index and remove it from disk
+     * 
+     * Only the file holding the session is rewritten: its day's segment, or
+     * the legacy focus_log.json for sessions recorded before segmentation.
+     * 
+     * @param filePath Path to focus_log.json
+     * @param sessions Loaded session headers
      * @param sessionIndex Index of session to delete
      * @return true if deleted successfully
      */
-    bool DeleteSession(std::vector<Session>& sessions, int sessionIndex);
+    bool DeleteSession(const std::string& filePath, std::vector<SessionHeader>& sessions, int sessionIndex);
 
 private:
-    // Helper to parse a single session from JSON
-    Session ParseSession(const nlohmann::json& sessionJson);
+    // A history file in load order
+    struct Source {
+        std::string path;
+        bool sealed;
+        ColumnarStore::SourceTag tag;
+    };
+    
+    // What the last load took from one source
+    struct LoadedSource {
+        std::string path;
+        bool sealed = false;
+        ColumnarStore::SourceTag tag;
+        size_t sessionCount = 0;
+        std::vector<SessionParser::Range> ranges;  // Byte ranges of its sessions (JSON sources)
+        uint64_t prefixChecksum = 0;               // HashBytes of everything before ranges.back()
+    };
+    
+    // How the journal's session was merged into the list
+    enum class ActiveMerge {
+        None,
+        Appended,
+        Replaced
+    };
     
-    // Helper to parse an application focus event
-    ApplicationFocusEvent ParseApplicationEvent(const nlohmann::json& appJson);
+    SegmentStore m_segments;
+    size_t m_lazySegments = DEFAULT_LAZY_SEGMENTS;
+    size_t m_unloadedSegments = 0;
+    
+    // State of the last load, for Refresh
+    std::vector<LoadedSource> m_loadedSources;
+    std::string m_loadedFilePath;
+    size_t m_loadedSessionCount = 0;
+    ColumnarStore::SourceTag m_journalTag;
+    ActiveMerge m_activeMerge = ActiveMerge::None;
+    size_t m_settledSessionCount = 0;
+    LoadProgress m_progress;
+
+    // Sources within the load window, with their current tags
+    std::vector<Source> ListSources(const std::string& filePath, LoadMode mode);
+
+    // Append the sessions of one {"sessions": [...]} file, decoded by SessionParser
+    bool LoadJsonFile(const std::string& path, std::vector<Session>& sessions);
+    
+    // Re-read a JSON source whose sessions end `sessions`, parsing only its changed tail
+    bool LoadJsonSource(LoadedSource& source, std::vector<SessionHeader>& sessions);
+    
+    // Append a sealed source (past day or legacy log), from its ColumnarStore
+    // snapshot when that is current; otherwise parse and write a new one.
+    // Day segments are only ever replaced by rename, so size and write time
+    // identify them; the legacy log is also checked with a sampled hash.
+    bool LoadSealedSource(const std::string& path, bool legacy, std::vector<SessionHeader>& sessions);
+    
+    // Append undecoded headers for every session of a store (tag checked if given)
+    static bool AppendFromStore(const std::string& storePath, const ColumnarStore::SourceTag* tag,
+                                std::vector<SessionHeader>& sessions);
+    
+    // Append headers that own their (moved) details
+    static void AppendDecoded(std::vector<Session>& parsed, std::vector<SessionHeader>& sessions);
+    
+    // Whole file into memory
+    static bool ReadFileContents(const std::string& path, std::string& contents);
+    
+    // history\2025-09-30.json -> history\2025-09-30.bbcs, focus_log.json -> focus_log.bbcs
+    static std::string GetStorePath(const std::string& jsonPath);
+
+    // Helper to append (or replace) the session recorded in the journal
+    ActiveMerge MergeActiveSession(const std::string& filePath, std::vector<SessionHeader>& sessions);
 };
 
 } // namespace viewer
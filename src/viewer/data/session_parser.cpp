@@ -0,0 +1,948 @@
+#include "session_parser.h"
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include "json.hpp"
+#include "structural_scanner.h"
+
+using json = nlohmann::json;
+
+namespace bigbrother {
+namespace viewer {
+
+namespace {
+
+/**
+ * @brief SAX handler that understands the session schema
+ *
+ * Keeps a stack of the containers it is inside. Containers it does not
+ * recognise are tracked as Skip, so everything inside them is ignored.
+ */
+class SessionSaxHandler : public nlohmann::json_sax<json> {
+public:
+    enum class Root {
+        Document,  // {"sessions": [...]}
+        Session    // A single session object
+    };
+
+    SessionSaxHandler(Root root, std::vector<Session>& sessions)
+        : m_root(root), m_sessions(sessions) {
+        m_stack.reserve(8);
+    }
+
+    bool null() override { m_field = Field::None; return true; }
+    bool boolean(bool) override { m_field = Field::None; return true; }
+    bool number_integer(number_integer_t value) override { SetNumber((long long)value); return true; }
+    bool number_unsigned(number_unsigned_t value) override { SetNumber((long long)value); return true; }
+    bool number_float(number_float_t value, const string_t&) override { SetNumber((long long)value); return true; }
+    bool binary(binary_t&) override { m_field = Field::None; return true; }
+
+    bool string(string_t& value) override {
+        switch (Top()) {
+        case Context::Session:
+            if (m_field == Field::Comment) m_session.comment = std::move(value);
+            break;
+        case Context::Application:
+            if (m_field == Field::ProcessName) m_application.process_name = std::move(value);
+            else if (m_field == Field::ProcessPath) m_application.process_path = std::move(value);
+            break;
+        case Context::Tab:
+            if (m_field == Field::WindowTitle) m_tab.window_title = std::move(value);
+            break;
+        default:
+            break;
+        }
+        m_field = Field::None;
+        return true;
+    }
+
+    bool start_object(std::size_t) override {
+        Context parent = Top();
+        Context context = Context::Skip;
+        if (parent == Context::Top) {
+            context = m_root == Root::Document ? Context::Document : Context::Session;
+        } else if (parent == Context::Sessions) {
+            context = Context::Session;
+        } else if (parent == Context::Applications) {
+            context = Context::Application;
+        } else if (parent == Context::Tabs) {
+            context = Context::Tab;
+        }
+
+        // Missing fields keep these defaults, like json::value() did
+        if (context == Context::Session) m_session = Session{};
+        if (context == Context::Application) m_application = ApplicationFocusEvent{};
+        if (context == Context::Tab) m_tab = TabInfo{};
+
+        m_stack.push_back(context);
+        m_field = Field::None;
+        return true;
+    }
+
+    bool end_object() override {
+        Context context = Top();
+        m_stack.pop_back();
+        if (context == Context::Session) {
+            m_sessions.push_back(std::move(m_session));
+        } else if (context == Context::Application) {
+            m_session.applications.push_back(std::move(m_application));
+        } else if (context == Context::Tab) {
+            m_application.tabs.push_back(std::move(m_tab));
+        }
+        m_field = Field::None;
+        return true;
+    }
+
+    bool start_array(std::size_t) override {
+        Context context = Context::Skip;
+        if (m_field == Field::Sessions) context = Context::Sessions;
+        else if (m_field == Field::Applications) context = Context::Applications;
+        else if (m_field == Field::Tabs) context = Context::Tabs;
+        m_stack.push_back(context);
+        m_field = Field::None;
+        return true;
+    }
+
+    bool end_array() override {
+        m_stack.pop_back();
+        m_field = Field::None;
+        return true;
+    }
+
+    bool key(string_t& name) override {
+        m_field = Field::None;
+        switch (Top()) {
+        case Context::Document:
+            if (name == "sessions") m_field = Field::Sessions;
+            break;
+        case Context::Session:
+            if (name == "start_timestamp") m_field = Field::StartTimestamp;
+            else if (name == "end_timestamp") m_field = Field::EndTimestamp;
+            else if (name == "comment") m_field = Field::Comment;
+            else if (name == "applications") m_field = Field::Applications;
+            break;
+        case Context::Application:
+            if (name == "process_name") m_field = Field::ProcessName;
+            else if (name == "process_path") m_field = Field::ProcessPath;
+            else if (name == "first_focus_time") m_field = Field::FirstFocusTime;
+            else if (name == "last_focus_time") m_field = Field::LastFocusTime;
+            else if (name == "total_time_spent_ms") m_field = Field::TotalTime;
+            else if (name == "tabs") m_field = Field::Tabs;
+            break;
+        case Context::Tab:
+            if (name == "window_title") m_field = Field::WindowTitle;
+            else if (name == "total_time_spent_ms") m_field = Field::TotalTime;
+            break;
+        default:
+            break;
+        }
+        return true;
+    }
+
+    bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) override {
+        return false;
+    }
+
+private:
+    enum class Context : unsigned char {
+        Top, Document, Sessions, Session, Applications, Application, Tabs, Tab, Skip
+    };
+
+    enum class Field : unsigned char {
+        None, Sessions,
+        StartTimestamp, EndTimestamp, Comment, Applications,
+        ProcessName, ProcessPath, FirstFocusTime, LastFocusTime, TotalTime, Tabs,
+        WindowTitle
+    };
+
+    Root m_root;
+    std::vector<Session>& m_sessions;
+    std::vector<Context> m_stack;
+    Field m_field = Field::None;
+
+    // Objects under construction; moved out when their closing brace arrives
+    Session m_session{};
+    ApplicationFocusEvent m_application{};
+    TabInfo m_tab{};
+
+    Context Top() const {
+        return m_stack.empty() ? Context::Top : m_stack.back();
+    }
+
+    void SetNumber(long long value) {
+        switch (Top()) {
+        case Context::Session:
+            if (m_field == Field::StartTimestamp) m_session.start_timestamp = value;
+            else if (m_field == Field::EndTimestamp) m_session.end_timestamp = value;
+            break;
+        case Context::Application:
+            if (m_field == Field::FirstFocusTime) m_application.first_focus_time = value;
+            else if (m_field == Field::LastFocusTime) m_application.last_focus_time = value;
+            else if (m_field == Field::TotalTime) m_application.total_time_spent_ms = value;
+            break;
+        case Context::Tab:
+            if (m_field == Field::TotalTime) m_tab.total_time_spent_ms = value;
+            break;
+        default:
+            break;
+        }
+        m_field = Field::None;
+    }
+};
+
+bool IsSpace(char c) {
+    return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+}
+
+const char* SkipSpace(const char* p, const char* end) {
+    while (p < end && IsSpace(*p)) {
+        p++;
+    }
+    return p;
+}
+
+bool IsPlainText(const char* begin, const char* end) {
+    for (const char* p = begin; p < end; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c < 0x20 || c >= 0x80 || c == '\\') {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Length of the UTF-8 sequence at `p`, or 0 if it is not well formed (the ranges nlohmann accepts)
+size_t Utf8Length(const unsigned char* p, const unsigned char* end) {
+    auto continues = [&](size_t i, unsigned char low, unsigned char high) {
+        return p + i < end && p[i] >= low && p[i] <= high;
+    };
+    unsigned char c = p[0];
+    if (c < 0x80) {
+        return 1;
+    }
+    if (c >= 0xC2 && c <= 0xDF) {
+        return continues(1, 0x80, 0xBF) ? 2 : 0;
+    }
+    if (c >= 0xE0 && c <= 0xEF) {
+        unsigned char low = c == 0xE0 ? 0xA0 : 0x80;
+        unsigned char high = c == 0xED ? 0x9F : 0xBF;
+        return continues(1, low, high) && continues(2, 0x80, 0xBF) ? 3 : 0;
+    }
+    if (c >= 0xF0 && c <= 0xF4) {
+        unsigned char low = c == 0xF0 ? 0x90 : 0x80;
+        unsigned char high = c == 0xF4 ? 0x8F : 0xBF;
+        return continues(1, low, high) && continues(2, 0x80, 0xBF) && continues(3, 0x80, 0xBF) ? 4 : 0;
+    }
+    return 0;
+}
+
+bool ReadHex4(const char* p, const char* end, unsigned& value) {
+    if (end - p < 4) {
+        return false;
+    }
+    value = 0;
+    for (int i = 0; i < 4; i++) {
+        char c = p[i];
+        unsigned digit;
+        if (c >= '0' && c <= '9') digit = c - '0';
+        else if (c >= 'a' && c <= 'f') digit = c - 'a' + 10;
+        else if (c >= 'A' && c <= 'F') digit = c - 'A' + 10;
+        else return false;
+        value = (value << 4) | digit;
+    }
+    return true;
+}
+
+void AppendUtf8(unsigned codePoint, std::string& out) {
+    if (codePoint < 0x80) {
+        out += (char)codePoint;
+    } else if (codePoint < 0x800) {
+        out += (char)(0xC0 | (codePoint >> 6));
+        out += (char)(0x80 | (codePoint & 0x3F));
+    } else if (codePoint < 0x10000) {
+        out += (char)(0xE0 | (codePoint >> 12));
+        out += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+        out += (char)(0x80 | (codePoint & 0x3F));
+    } else {
+        out += (char)(0xF0 | (codePoint >> 18));
+        out += (char)(0x80 | ((codePoint >> 12) & 0x3F));
+        out += (char)(0x80 | ((codePoint >> 6) & 0x3F));
+        out += (char)(0x80 | (codePoint & 0x3F));
+    }
+}
+
+// Decode the contents of a JSON string (between its quotes), validating it like nlohmann does
+bool DecodeString(const char* begin, const char* end, std::string& out) {
+    out.clear();
+    const char* p = begin;
+    while (p < end) {
+        unsigned char c = (unsigned char)*p;
+        if (c >= 0x80) {
+            size_t length = Utf8Length((const unsigned char*)p, (const unsigned char*)end);
+            if (length == 0) {
+                return false;
+            }
+            out.append(p, length);
+            p += length;
+            continue;
+        }
+        if (c < 0x20) {
+            return false;
+        }
+        if (c != '\\') {
+            const char* run = p;
+            while (p < end && (unsigned char)*p >= 0x20 && (unsigned char)*p < 0x80 && *p != '\\') {
+                p++;
+            }
+            out.append(run, p);
+            continue;
+        }
+
+        if (++p == end) {
+            return false;
+        }
+        switch (*p++) {
+        case '"': out += '"'; break;
+        case '\\': out += '\\'; break;
+        case '/': out += '/'; break;
+        case 'b': out += '\b'; break;
+        case 'f': out += '\f'; break;
+        case 'n': out += '\n'; break;
+        case 'r': out += '\r'; break;
+        case 't': out += '\t'; break;
+        case 'u': {
+            unsigned codePoint;
+            if (!ReadHex4(p, end, codePoint)) {
+                return false;
+            }
+            p += 4;
+            if (codePoint >= 0xDC00 && codePoint <= 0xDFFF) {
+                return false;  // Low surrogate without a high one
+            }
+            if (codePoint >= 0xD800 && codePoint <= 0xDBFF) {
+                unsigned low;
+                if (end - p < 2 || p[0] != '\\' || p[1] != 'u' || !ReadHex4(p + 2, end, low) ||
+                    low < 0xDC00 || low > 0xDFFF) {
+                    return false;
+                }
+                p += 6;
+                codePoint = 0x10000 + ((codePoint - 0xD800) << 10) + (low - 0xDC00);
+            }
+            AppendUtf8(codePoint, out);
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Decodes the session schema straight from a StructuralScanner
+ *
+ * Applies the same rules as SessionSaxHandler (unknown keys skipped,
+ * mistyped fields ignored) and validates everything it walks. It fails on
+ * anything it does not convert exactly like nlohmann, such as numbers with
+ * a fraction or an exponent; callers then fall back to SessionSaxHandler.
+ */
+class SessionDecoder {
+public:
+    SessionDecoder(const char* begin, const char* end)
+        : m_begin(begin), m_end(end), m_scanner(begin, end) {
+        m_next = m_scanner.Next();
+    }
+
+    bool DecodeDocument(std::vector<Session>& sessions) {
+        ValueKind kind;
+        if (!NextValue(kind)) {
+            return false;
+        }
+        if (kind != ValueKind::Object) {
+            return SkipRest(kind) && AtEnd();
+        }
+        bool decoded = DecodeObject([&](std::string_view key) {
+            if (key == "sessions") {
+                return ReadObjects([&]() {
+                    Session session{};
+                    if (!DecodeSession(session)) {
+                        return false;
+                    }
+                    sessions.push_back(std::move(session));
+                    return true;
+                });
+            }
+            return SkipValue();
+        });
+        return decoded && AtEnd();
+    }
+
+    bool DecodeSingleSession(Session& session) {
+        ValueKind kind;
+        return NextValue(kind) && kind == ValueKind::Object && DecodeSession(session) && AtEnd();
+    }
+
+private:
+    enum class ValueKind {
+        Object, Array, String, Number, Literal
+    };
+
+    static constexpr size_t NONE = StructuralScanner::NONE;
+
+    const char* m_begin;
+    const char* m_end;
+    StructuralScanner m_scanner;
+
+    size_t m_next = NONE;          // Lookahead: next structural not consumed yet
+    size_t m_consumed = 0;         // One past the last byte consumed
+    char m_char = 0;               // Last structural consumed
+
+    // Last string or scalar read by NextValue
+    const char* m_valueBegin = nullptr;
+    const char* m_valueEnd = nullptr;
+    long long m_integer = 0;
+
+    std::string m_key;             // Keys that needed unescaping
+    std::string m_scratch;         // Strings that are only validated
+    std::vector<char> m_closers;   // Containers being skipped
+
+    // Consume the next structural; only whitespace may come before it
+    bool Advance() {
+        if (m_next == NONE || SkipSpace(m_begin + m_consumed, m_begin + m_next) != m_begin + m_next) {
+            return false;
+        }
+        m_char = m_begin[m_next];
+        m_consumed = m_next + 1;
+        m_next = m_scanner.Next();
+        return true;
+    }
+
+    bool NextIs(char c) const {
+        return m_next != NONE && m_begin[m_next] == c &&
+               SkipSpace(m_begin + m_consumed, m_begin + m_next) == m_begin + m_next;
+    }
+
+    bool AtEnd() const {
+        return m_next == NONE && SkipSpace(m_begin + m_consumed, m_end) == m_end;
+    }
+
+    // After an opening quote: the next structural is always the closing one
+    bool ReadStringBody() {
+        if (m_next == NONE || m_begin[m_next] != '"') {
+            return false;
+        }
+        m_valueBegin = m_begin + m_consumed;
+        m_valueEnd = m_begin + m_next;
+        m_consumed = m_next + 1;
+        m_next = m_scanner.Next();
+        return true;
+    }
+
+    // Read the start of a value: the opening bracket of a container, a whole string or a whole scalar
+    bool NextValue(ValueKind& kind) {
+        const char* start = SkipSpace(m_begin + m_consumed, m_end);
+        if (m_next != NONE && start == m_begin + m_next) {
+            Advance();
+            switch (m_char) {
+            case '{': kind = ValueKind::Object; return true;
+            case '[': kind = ValueKind::Array; return true;
+            case '"': kind = ValueKind::String; return ReadStringBody();
+            default: return false;
+            }
+        }
+
+        // A scalar runs up to the next structural, less trailing whitespace
+        const char* limit = m_next == NONE ? m_end : m_begin + m_next;
+        const char* stop = start;
+        while (stop < limit && !IsSpace(*stop)) {
+            stop++;
+        }
+        if (stop == start || SkipSpace(stop, limit) != limit) {
+            return false;
+        }
+        m_valueBegin = start;
+        m_valueEnd = stop;
+        m_consumed = stop - m_begin;
+
+        size_t length = stop - start;
+        if ((length == 4 && memcmp(start, "true", 4) == 0) || (length == 5 && memcmp(start, "false", 5) == 0) ||
+            (length == 4 && memcmp(start, "null", 4) == 0)) {
+            kind = ValueKind::Literal;
+            return true;
+        }
+        kind = ValueKind::Number;
+        return ParseInteger(start, stop);
+    }
+
+    // Integers of up to 18 digits, which always fit a long long. Anything
+    // else (fractions, exponents, huge values) is left to nlohmann, which
+    // also rejects values that overflow a double.
+    bool ParseInteger(const char* p, const char* end) {
+        bool negative = p < end && *p == '-';
+        if (negative) {
+            p++;
+        }
+        size_t digitCount = end - p;
+        if (digitCount == 0 || digitCount > 18 || (*p == '0' && digitCount > 1)) {
+            return false;
+        }
+        long long value = 0;
+        for (; p < end; p++) {
+            if (*p < '0' || *p > '9') {
+                return false;
+            }
+            value = value * 10 + (*p - '0');
+        }
+        m_integer = negative ? -value : value;
+        return true;
+    }
+
+    bool ValidateString() {
+        return IsPlainText(m_valueBegin, m_valueEnd) || DecodeString(m_valueBegin, m_valueEnd, m_scratch);
+    }
+
+    bool ReadKey(std::string_view& key) {
+        if (!Advance() || m_char != '"' || !ReadStringBody()) {
+            return false;
+        }
+        if (IsPlainText(m_valueBegin, m_valueEnd)) {
+            key = std::string_view(m_valueBegin, m_valueEnd - m_valueBegin);
+        } else if (DecodeString(m_valueBegin, m_valueEnd, m_key)) {
+            key = m_key;
+        } else {
+            return false;
+        }
+        return Advance() && m_char == ':';
+    }
+
+    // Rest of a value whose start NextValue returned, ignoring its contents
+    bool SkipRest(ValueKind kind) {
+        if (kind == ValueKind::String) {
+            return ValidateString();
+        }
+        if (kind != ValueKind::Object && kind != ValueKind::Array) {
+            return true;
+        }
+
+        // Iterative, so deeply nested input cannot exhaust the stack
+        m_closers.assign(1, kind == ValueKind::Object ? '}' : ']');
+        bool opened = true;
+        while (!m_closers.empty()) {
+            char closer = m_closers.back();
+            if (opened && NextIs(closer)) {
+                Advance();
+                m_closers.pop_back();
+                opened = false;
+                continue;
+            }
+            if (!opened) {
+                if (!Advance()) {
+                    return false;
+                }
+                if (m_char == closer) {
+                    m_closers.pop_back();
+                    continue;
+                }
+                if (m_char != ',') {
+                    return false;
+                }
+            }
+            std::string_view key;
+            if (closer == '}' && !ReadKey(key)) {
+                return false;
+            }
+            ValueKind member;
+            if (!NextValue(member)) {
+                return false;
+            }
+            opened = member == ValueKind::Object || member == ValueKind::Array;
+            if (opened) {
+                m_closers.push_back(member == ValueKind::Object ? '}' : ']');
+            } else if (member == ValueKind::String && !ValidateString()) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool SkipValue() {
+        ValueKind kind;
+        return NextValue(kind) && SkipRest(kind);
+    }
+
+    // Current structural is '{'; onMember(key) must consume the member's value
+    template <typename OnMember>
+    bool DecodeObject(OnMember onMember) {
+        if (NextIs('}')) {
+            return Advance();
+        }
+        do {
+            std::string_view key;
+            if (!ReadKey(key) || !onMember(key) || !Advance()) {
+                return false;
+            }
+        } while (m_char == ',');
+        return m_char == '}';
+    }
+
+    // Reads an array value, calling onObject at each object element; anything else is skipped
+    template <typename OnObject>
+    bool ReadObjects(OnObject onObject) {
+        ValueKind kind;
+        if (!NextValue(kind)) {
+            return false;
+        }
+        if (kind != ValueKind::Array) {
+            return SkipRest(kind);
+        }
+        if (NextIs(']')) {
+            return Advance();
+        }
+        do {
+            ValueKind element;
+            if (!NextValue(element)) {
+                return false;
+            }
+            bool read = element == ValueKind::Object ? onObject() : SkipRest(element);
+            if (!read || !Advance()) {
+                return false;
+            }
+        } while (m_char == ',');
+        return m_char == ']';
+    }
+
+    bool ReadInteger(long long& value) {
+        ValueKind kind;
+        if (!NextValue(kind)) {
+            return false;
+        }
+        if (kind != ValueKind::Number) {
+            return SkipRest(kind);
+        }
+        value = m_integer;
+        return true;
+    }
+
+    bool ReadString(std::string& value) {
+        ValueKind kind;
+        if (!NextValue(kind)) {
+            return false;
+        }
+        if (kind != ValueKind::String) {
+            return SkipRest(kind);
+        }
+        if (IsPlainText(m_valueBegin, m_valueEnd)) {
+            value.assign(m_valueBegin, m_valueEnd);
+            return true;
+        }
+        return DecodeString(m_valueBegin, m_valueEnd, value);
+    }
+
+    bool DecodeSession(Session& session) {
+        return DecodeObject([&](std::string_view key) {
+            if (key == "start_timestamp") return ReadInteger(session.start_timestamp);
+            if (key == "end_timestamp") return ReadInteger(session.end_timestamp);
+            if (key == "comment") return ReadString(session.comment);
+            if (key == "applications") {
+                return ReadObjects([&]() {
+                    ApplicationFocusEvent application{};
+                    if (!DecodeApplication(application)) {
+                        return false;
+                    }
+                    session.applications.push_back(std::move(application));
+                    return true;
+                });
+            }
+            return SkipValue();
+        });
+    }
+
+    bool DecodeApplication(ApplicationFocusEvent& application) {
+        return DecodeObject([&](std::string_view key) {
+            if (key == "process_name") return ReadString(application.process_name);
+            if (key == "process_path") return ReadString(application.process_path);
+            if (key == "first_focus_time") return ReadInteger(application.first_focus_time);
+            if (key == "last_focus_time") return ReadInteger(application.last_focus_time);
+            if (key == "total_time_spent_ms") return ReadInteger(application.total_time_spent_ms);
+            if (key == "tabs") {
+                return ReadObjects([&]() {
+                    TabInfo tab{};
+                    if (!DecodeTab(tab)) {
+                        return false;
+                    }
+                    application.tabs.push_back(std::move(tab));
+                    return true;
+                });
+            }
+            return SkipValue();
+        });
+    }
+
+    bool DecodeTab(TabInfo& tab) {
+        return DecodeObject([&](std::string_view key) {
+            if (key == "window_title") return ReadString(tab.window_title);
+            if (key == "total_time_spent_ms") return ReadInteger(tab.total_time_spent_ms);
+            return SkipValue();
+        });
+    }
+};
+
+} // namespace
+
+bool SessionParser::ParseDocument(std::istream& input, std::vector<Session>& sessions) {
+    SessionSaxHandler handler(SessionSaxHandler::Root::Document, sessions);
+    try {
+        return json::sax_parse(input, &handler);
+    } catch (const json::exception& e) {
+        return false;
+    }
+}
+
+bool SessionParser::ParseDocument(const char* begin, const char* end, std::vector<Session>& sessions) {
+    size_t count = sessions.size();
+    SessionDecoder decoder(begin, end);
+    if (decoder.DecodeDocument(sessions)) {
+        return true;
+    }
+    // Malformed, or something only nlohmann converts: it also decides what prefix to keep
+    sessions.erase(sessions.begin() + count, sessions.end());
+
+    SessionSaxHandler handler(SessionSaxHandler::Root::Document, sessions);
+    try {
+        return json::sax_parse(begin, end, &handler);
+    } catch (const json::exception& e) {
+        return false;
+    }
+}
+
+bool SessionParser::ParseSession(const char* begin, const char* end, Session& session) {
+    Session decoded{};
+    SessionDecoder decoder(begin, end);
+    if (decoder.DecodeSingleSession(decoded)) {
+        session = std::move(decoded);
+        return true;
+    }
+
+    std::vector<Session> parsed;
+    SessionSaxHandler handler(SessionSaxHandler::Root::Session, parsed);
+    try {
+        if (!json::sax_parse(begin, end, &handler) || parsed.size() != 1) {
+            return false;
+        }
+    } catch (const json::exception& e) {
+        return false;
+    }
+    session = std::move(parsed.front());
+    return true;
+}
+
+bool SessionParser::FindSessions(const char* begin, const char* end, std::vector<Range>& ranges) {
+    const char* p = SkipSpace(begin, end);
+    if (p == end || *p != '{') {
+        return false;
+    }
+    return ScanSessions(begin, end, p, 0, false, ranges);
+}
+
+bool SessionParser::FindSessionsFrom(const char* begin, const char* end, size_t offset, std::vector<Range>& ranges) {
+    if (offset > (size_t)(end - begin)) {
+        return false;
+    }
+    return ScanSessions(begin, end, begin + offset, 2, true, ranges);
+}
+
+bool SessionParser::ScanSessions(const char* begin, const char* end, const char* p, size_t depth, bool inSessions,
+                                 std::vector<Range>& ranges) {
+    static const char SESSIONS_KEY[] = "\"sessions\"";
+    static const char RESUMED_HEAD[] = "{\"sessions\":[";
+    const size_t keyLength = sizeof(SESSIONS_KEY) - 1;
+
+    // Directly inside the sessions array only whitespace, commas and session
+    // objects may appear; anything else is left to the sequential parser
+    enum class Expect {
+        ElementOrClose,
+        Element,
+        SeparatorOrClose
+    };
+
+    StructuralScanner scanner(p, end);
+    const bool resumed = inSessions;     // Started just past a session (FindSessionsFrom)
+    Expect expect = Expect::SeparatorOrClose;
+    const char* gapStart = p;            // Just past the last array token seen
+    const char* sessionStart = nullptr;
+    const char* afterKey = nullptr;      // Just past a root-level "sessions" key
+    const char* afterColon = nullptr;    // Just past the colon that follows it
+    const char* headEnd = nullptr;       // Just past the first sessions array's '['
+    const char* tailStart = nullptr;     // Its closing ']'
+
+    for (size_t offset = scanner.Next(); offset != StructuralScanner::NONE; offset = scanner.Next()) {
+        const char* s = p + offset;
+        char c = *s;
+        const char* key = afterKey;
+        const char* colon = afterColon;
+        afterKey = afterColon = nullptr;
+
+        if (inSessions && depth == 2) {
+            if (SkipSpace(gapStart, s) != s) {
+                return false;
+            }
+            if (c == ',') {
+                if (expect != Expect::SeparatorOrClose) {
+                    return false;
+                }
+                expect = Expect::Element;
+                gapStart = s + 1;
+                continue;
+            }
+            if (c == '{') {
+                if (expect == Expect::SeparatorOrClose) {
+                    return false;
+                }
+                sessionStart = s;
+                depth++;
+                continue;
+            }
+            if (c != ']' || expect == Expect::Element) {
+                return false;
+            }
+        }
+
+        if (c == '"') {
+            // Strings are reported as their opening and closing quote
+            size_t close = scanner.Next();
+            if (close == StructuralScanner::NONE) {
+                return false;
+            }
+            const char* stringEnd = p + close + 1;
+            if (depth == 1 && (size_t)(stringEnd - s) == keyLength && memcmp(s, SESSIONS_KEY, keyLength) == 0) {
+                afterKey = stringEnd;
+            }
+            continue;
+        }
+        if (c == ':') {
+            if (key && SkipSpace(key, s) == s) {
+                afterColon = s + 1;
+            }
+            continue;
+        }
+        if (c == ',') {
+            continue;
+        }
+
+        if (c == '{' || c == '[') {
+            if (c == '[' && colon && SkipSpace(colon, s) == s) {
+                // The array of a root-level "sessions" key
+                inSessions = true;
+                expect = Expect::ElementOrClose;
+                gapStart = s + 1;
+                if (!headEnd) {
+                    headEnd = s + 1;
+                }
+            }
+            depth++;
+        } else {
+            if (depth == 0) {
+                return false;
+            }
+            depth--;
+            if (inSessions && depth == 2 && sessionStart) {
+                ranges.push_back({ (size_t)(sessionStart - begin), (size_t)(s + 1 - begin) });
+                sessionStart = nullptr;
+                expect = Expect::SeparatorOrClose;
+                gapStart = s + 1;
+            } else if (inSessions && depth == 1) {
+                inSessions = false;
+                if (!tailStart) {
+                    tailStart = s;
+                }
+            } else if (depth == 0) {
+                // Root closed. ParseSession checks the sessions; the rest of
+                // the document is checked here with the array emptied out.
+                std::string outline = resumed ? std::string(RESUMED_HEAD) : std::string(begin, headEnd ? headEnd : end);
+                if (tailStart) {
+                    outline.append(tailStart, end);
+                }
+                return json::accept(outline);
+            }
+        }
+    }
+    return false;
+}
+
+bool SessionParser::ParseSessions(const char* begin, const std::vector<Range>& ranges, std::vector<Session>& sessions,
+                                  unsigned threadCount, std::atomic<uint64_t>* bytesParsed) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    const size_t batchCount = (ranges.size() + PARALLEL_BATCH_SIZE - 1) / PARALLEL_BATCH_SIZE;
+    threadCount = (unsigned)std::min<size_t>(threadCount, batchCount);
+
+    // Each session is parsed into its own slot, so the merge keeps file order
+    std::vector<Session> parsed(ranges.size());
+    std::atomic<size_t> nextBatch{ 0 };
+    std::atomic<bool> failed{ false };
+
+    auto worker = [&]() {
+        for (;;) {
+            size_t batch = nextBatch.fetch_add(1, std::memory_order_relaxed);
+            if (batch >= batchCount || failed.load(std::memory_order_relaxed)) {
+                return;
+            }
+            size_t last = std::min(ranges.size(), (batch + 1) * PARALLEL_BATCH_SIZE);
+            for (size_t i = batch * PARALLEL_BATCH_SIZE; i < last; i++) {
+                if (!ParseSession(begin + ranges[i].begin, begin + ranges[i].end, parsed[i])) {
+                    failed.store(true, std::memory_order_relaxed);
+                    return;
+                }
+            }
+            if (bytesParsed) {
+                bytesParsed->fetch_add(ranges[last - 1].end - ranges[batch * PARALLEL_BATCH_SIZE].begin,
+                                       std::memory_order_relaxed);
+            }
+        }
+    };
+
+    // The calling thread works too
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < threadCount; i++) {
+        try {
+            workers.emplace_back(worker);
+        } catch (const std::system_error&) {
+            break;
+        }
+    }
+    worker();
+    for (auto& thread : workers) {
+        thread.join();
+    }
+
+    if (failed.load()) {
+        return false;
+    }
+
+    sessions.reserve(sessions.size() + parsed.size());
+    sessions.insert(sessions.end(), std::make_move_iterator(parsed.begin()), std::make_move_iterator(parsed.end()));
+    return true;
+}
+
+bool SessionParser::ParseDocumentParallel(const char* begin, const char* end, std::vector<Session>& sessions,
+                                          unsigned threadCount, std::atomic<uint64_t>* bytesParsed) {
+    if (threadCount == 0) {
+        threadCount = std::max(1u, std::thread::hardware_concurrency());
+    }
+    std::vector<Range> ranges;
+    if (threadCount == 1 || !FindSessions(begin, end, ranges) ||
+        !ParseSessions(begin, ranges, sessions, threadCount, bytesParsed)) {
+        // Single core, or malformed somewhere: the sequential parser keeps the valid prefix
+        return ParseDocument(begin, end, sessions);
+    }
+    return true;
+}
+
+} // namespace viewer
+} // namespace bigbrother
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <vector>
+#include "session_data.h"
+
+namespace bigbrother {
+namespace viewer {
+
+/**
+ * @brief Streaming parser for the focus_log.json schema
+ *
+ * Built on nlohmann's SAX interface: Session, ApplicationFocusEvent and
+ * TabInfo are filled directly while the input is read, so no json tree is
+ * ever built and peak memory stays close to the size of the result. Unknown
+ * keys are skipped, and fields with an unexpected type keep their defaults.
+ *
+ * Input already in memory first goes through a schema-specific decoder
+ * driven by StructuralScanner (SIMD structural indexing); only input it
+ * cannot handle exactly like nlohmann is handed to the SAX parser.
+ *
+ * Large documents already in memory can be split at session boundaries by a
+ * structural pre-scan and parsed on several threads (ParseDocumentParallel).
+ */
+class SessionParser {
+public:
+    /**
+     * @brief Byte range [begin, end) of one element of the "sessions" array
+     */
+    struct Range {
+        size_t begin;
+        size_t end;
+    };
+
+    /** @brief Sessions handed to a worker at a time */
+    static constexpr size_t PARALLEL_BATCH_SIZE = 64;
+
+    /**
+     * @brief Append every session of a {"sessions": [...]} document
+     * @param input Stream positioned at the document
+     * @param sessions Receives the sessions, in file order
+     * @return false if the JSON is malformed (sessions before the error are kept)
+     */
+    static bool ParseDocument(std::istream& input, std::vector<Session>& sessions);
+
+    /**
+     * @brief Same as above, for a document already in memory
+     */
+    static bool ParseDocument(const char* begin, const char* end, std::vector<Session>& sessions);
+
+    /**
+     * @brief Parse one element of the "sessions" array
+     * @param begin First byte of the session object
+     * @param end One past its closing brace
+     * @param session Receives the session
+     * @return false if the range is not a well-formed session object
+     */
+    static bool ParseSession(const char* begin, const char* end, Session& session);
+
+    /**
+     * @brief Locate every session object without parsing it
+     *
+     * Only walks StructuralScanner's positions tracking bracket depth, so it
+     * runs at close to memory speed. The session objects themselves are not
+     * validated; ParseSession does that. Everything around them is: only
+     * whitespace and single commas may separate them, and the rest of the
+     * document must be well-formed, so a successful scan whose sessions all
+     * parse means the whole document is valid.
+     *
+     * @param begin Start of a {"sessions": [...]} document
+     * @param end One past its last byte
+     * @param ranges Receives one range per session object, in file order
+     * @return false if the document structure is not the expected one
+     */
+    static bool FindSessions(const char* begin, const char* end, std::vector<Range>& ranges);
+
+    /**
+     * @brief Continue FindSessions just past a session in the array
+     *
+     * Validates everything from `offset` on like FindSessions does; the
+     * bytes before it are the caller's responsibility.
+     *
+     * @param offset End of a session, as recorded in an earlier Range
+     */
+    static bool FindSessionsFrom(const char* begin, const char* end, size_t offset, std::vector<Range>& ranges);
+
+    /**
+     * @brief Parse the given session ranges on a pool of worker threads
+     *
+     * Batches of sessions are parsed concurrently and appended in range order.
+     *
+     * @param begin Document the ranges refer to
+     * @param threadCount Worker threads; 0 uses one per hardware thread
+     * @param bytesParsed If set, advanced by the size of each finished batch
+     * @return false if any range is malformed (`sessions` is left unchanged)
+     */
+    static bool ParseSessions(const char* begin, const std::vector<Range>& ranges, std::vector<Session>& sessions,
+                              unsigned threadCount = 0, std::atomic<uint64_t>* bytesParsed = nullptr);
+
+    /**
+     * @brief ParseDocument split across a pool of worker threads
+     *
+     * FindSessions followed by ParseSessions. If the pre-scan or any session
+     * fails, the document is re-parsed sequentially so the result matches
+     * ParseDocument exactly.
+     *
+     * @param threadCount Worker threads; 0 uses one per hardware thread, 1 parses sequentially
+     * @param bytesParsed As for ParseSessions
+     */
+    static bool ParseDocumentParallel(const char* begin, const char* end, std::vector<Session>& sessions,
+                                      unsigned threadCount = 0, std::atomic<uint64_t>* bytesParsed = nullptr);
+
+private:
+    static bool ScanSessions(const char* begin, const char* end, const char* p, size_t depth, bool inSessions,
+                             std::vector<Range>& ranges);
+};
+
+} // namespace viewer
+} // namespace bigbrother
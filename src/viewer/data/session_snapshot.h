@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "session_index.h"
+#include "session_stats.h"
+
+namespace bigbrother {
+namespace viewer {
+
+/**
+ * @brief Immutable, reference-counted list of loaded session headers
+ *
+ * Published by BackgroundLoader and read by the UI. Settled history (days the
+ * monitor no longer writes) is shared between consecutive snapshots, so a
+ * live update only copies the headers of today's segment and the journal.
+ */
+class SessionSnapshot {
+public:
+    SessionSnapshot() : m_settled(std::make_shared<const std::vector<SessionHeader>>()) {}
+
+    /**
+     * @param stats Statistics over settled and recent sessions together; the
+     *        caller counts them, so settled days are not counted again
+     */
+    SessionSnapshot(std::shared_ptr<const std::vector<SessionHeader>> settled, std::vector<SessionHeader> recent,
+                    size_t unloadedSegments, uint64_t generation, SessionStats stats)
+        : m_settled(std::move(settled))
+        , m_recent(std::move(recent))
+        , m_unloadedSegments(unloadedSegments)
+        , m_generation(generation)
+        , m_stats(std::move(stats)) {}
+
+    size_t size() const { return m_settled->size() + m_recent.size(); }
+    bool empty() const { return size() == 0; }
+
+    const SessionHeader& operator[](size_t index) const {
+        size_t settled = m_settled->size();
+        return index < settled ? (*m_settled)[index] : m_recent[index - settled];
+    }
+
+    /**
+     * @brief History sources the lazy window left out
+     */
+    size_t GetUnloadedSegmentCount() const { return m_unloadedSegments; }
+
+    /**
+     * @brief Increases with every snapshot the loader publishes
+     */
+    uint64_t GetGeneration() const { return m_generation; }
+
+    /**
+     * @brief The settled part, for sharing with the next snapshot
+     */
+    const std::shared_ptr<const std::vector<SessionHeader>>& GetSettled() const { return m_settled; }
+
+    /**
+     * @brief Counts and per-program totals over all sessions of this snapshot
+     */
+    const SessionStats& GetStats() const { return m_stats; }
+
+private:
+    std::shared_ptr<const std::vector<SessionHeader>> m_settled;
+    std::vector<SessionHeader> m_recent;
+    size_t m_unloadedSegments = 0;
+    uint64_t m_generation = 0;
+    SessionStats m_stats;
+};
+
+} // namespace viewer
+} // namespace bigbrother
@@ -0,0 +1,85 @@
+#include "session_stats.h"
+
+namespace bigbrother {
+namespace viewer {
+
+namespace {
+
+// Call f(processName, totalTimeMs) for each application of a session;
+// sealed sessions are read from their store without decoding tabs
+template <typename F>
+void ForEachApplication(const SessionHeader& session, F f) {
+    if (session.details) {
+        for (const auto& app : session.details->applications) {
+            f(app.process_name, app.total_time_spent_ms);
+        }
+    } else if (session.store) {
+        ColumnarStore::SessionView view = session.store->GetSession(session.store_index);
+        std::string name;
+        for (size_t i = 0; i < view.GetApplicationCount(); i++) {
+            ColumnarStore::ApplicationView app = view.GetApplication(i);
+            name.assign(app.GetProcessName());
+            f(name, app.GetTotalTimeMs());
+        }
+    }
+}
+
+} // namespace
+
+void SessionStats::Add(const SessionHeader& session) {
+    m_sessionCount++;
+    m_applicationCount += session.application_count;
+    m_tabCount += session.tab_count;
+    m_trackedSeconds += session.end_timestamp - session.start_timestamp;
+
+    ForEachApplication(session, [this](const std::string& processName, long long totalTimeMs) {
+        AddApplication(processName, totalTimeMs);
+    });
+}
+
+void SessionStats::Remove(const SessionHeader& session) {
+    m_sessionCount--;
+    m_applicationCount -= session.application_count;
+    m_tabCount -= session.tab_count;
+    m_trackedSeconds -= session.end_timestamp - session.start_timestamp;
+
+    ForEachApplication(session, [this](const std::string& processName, long long totalTimeMs) {
+        RemoveApplication(processName, totalTimeMs);
+    });
+}
+
+void SessionStats::AddApplication(const std::string& processName, long long totalTimeMs) {
+    auto it = m_applicationIndex.find(processName);
+    if (it == m_applicationIndex.end()) {
+        it = m_applicationIndex.emplace(processName, (uint32_t)m_applications.size()).first;
+        m_applications.push_back({ processName, 0, 0 });
+    }
+    ApplicationTotal& total = m_applications[it->second];
+    total.total_time_ms += totalTimeMs;
+    total.session_count++;
+}
+
+void SessionStats::RemoveApplication(const std::string& processName, long long totalTimeMs) {
+    auto it = m_applicationIndex.find(processName);
+    if (it == m_applicationIndex.end()) {
+        return;
+    }
+    uint32_t index = it->second;
+    ApplicationTotal& total = m_applications[index];
+    total.total_time_ms -= totalTimeMs;
+    if (--total.session_count > 0) {
+        return;
+    }
+
+    // Its last session is gone: drop the program, keeping first-seen order
+    m_applicationIndex.erase(it);
+    m_applications.erase(m_applications.begin() + index);
+    for (auto& entry : m_applicationIndex) {
+        if (entry.second > index) {
+            entry.second--;
+        }
+    }
+}
+
+} // namespace viewer
+} // namespace bigbrother
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "session_index.h"
+
+namespace bigbrother {
+namespace viewer {
+
+/**
+ * @brief Aggregate statistics over a list of sessions
+ *
+ * Built on the loader thread as sessions are published and read by the UI
+ * in O(1). The loader keeps the statistics of the settled history and only
+ * removes and adds the sessions that changed: appended days, a deleted
+ * session and the day it was deleted from.
+ */
+class SessionStats {
+public:
+    /**
+     * @brief Time spent in one program over all sessions
+     */
+    struct ApplicationTotal {
+        std::string process_name;
+        long long total_time_ms = 0;
+        uint32_t session_count = 0;     // Sessions the program appears in
+    };
+
+    /**
+     * @brief Count a session; sealed sessions are read from their store without decoding tabs
+     */
+    void Add(const SessionHeader& session);
+
+    /**
+     * @brief Uncount a session given to Add earlier; a program leaves the totals with its last session
+     */
+    void Remove(const SessionHeader& session);
+
+    size_t GetSessionCount() const { return m_sessionCount; }
+    size_t GetApplicationCount() const { return m_applicationCount; }
+    size_t GetTabCount() const { return m_tabCount; }
+
+    /**
+     * @brief Sum of session durations in seconds
+     */
+    long long GetTrackedSeconds() const { return m_trackedSeconds; }
+
+    /**
+     * @brief One entry per program, in first-seen order
+     */
+    const std::vector<ApplicationTotal>& GetApplicationTotals() const { return m_applications; }
+
+private:
+    size_t m_sessionCount = 0;
+    size_t m_applicationCount = 0;
+    size_t m_tabCount = 0;
+    long long m_trackedSeconds = 0;
+    std::vector<ApplicationTotal> m_applications;
+    std::unordered_map<std::string, uint32_t> m_applicationIndex;   // process name -> index in m_applications
+
+    void AddApplication(const std::string& processName, long long totalTimeMs);
+    void RemoveApplication(const std::string& processName, long long totalTimeMs);
+};
+
+} // namespace viewer
+} // namespace bigbrother
@@ -0,0 +1,239 @@
+#include "structural_scanner.h"
+#include <cstring>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define BB_SCANNER_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+// MSVC accepts AVX2 intrinsics in any function; GCC and Clang need them enabled per function
+#if defined(__GNUC__) || defined(__clang__)
+#define BB_TARGET_SSE2 __attribute__((target("sse2")))
+#define BB_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define BB_TARGET_SSE2
+#define BB_TARGET_AVX2
+#endif
+
+namespace bigbrother {
+namespace viewer {
+
+namespace {
+
+const uint64_t EVEN_BITS = 0x5555555555555555ull;
+
+unsigned TrailingZeros(uint64_t value) {
+#if defined(_MSC_VER) && defined(_M_X64)
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return (unsigned)index;
+#elif defined(__GNUC__) || defined(__clang__)
+    return (unsigned)__builtin_ctzll(value);
+#else
+    unsigned count = 0;
+    while (!(value & 1)) {
+        value >>= 1;
+        count++;
+    }
+    return count;
+#endif
+}
+
+// Bit i of the result is the xor of bits 0..i: set from an opening quote up to its closing quote
+uint64_t PrefixXor(uint64_t bits) {
+    bits ^= bits << 1;
+    bits ^= bits << 2;
+    bits ^= bits << 4;
+    bits ^= bits << 8;
+    bits ^= bits << 16;
+    bits ^= bits << 32;
+    return bits;
+}
+
+StructuralScanner::Level DetectLevel() {
+#if defined(BB_SCANNER_X86) && defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+    __cpuid(info, 1);
+    bool sse2 = (info[3] & (1 << 26)) != 0;
+    bool osSavesYmm = (info[2] & (1 << 27)) && (info[2] & (1 << 28)) && (_xgetbv(0) & 6) == 6;
+    bool avx2 = false;
+    if (maxLeaf >= 7 && osSavesYmm) {
+        __cpuidex(info, 7, 0);
+        avx2 = (info[1] & (1 << 5)) != 0;
+    }
+    return avx2 ? StructuralScanner::Level::AVX2
+         : sse2 ? StructuralScanner::Level::SSE2
+                : StructuralScanner::Level::Scalar;
+#elif defined(BB_SCANNER_X86)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") ? StructuralScanner::Level::AVX2
+         : __builtin_cpu_supports("sse2") ? StructuralScanner::Level::SSE2
+                                          : StructuralScanner::Level::Scalar;
+#else
+    return StructuralScanner::Level::Scalar;
+#endif
+}
+
+} // namespace
+
+StructuralScanner::Level StructuralScanner::GetBestLevel() {
+    static const Level level = DetectLevel();
+    return level;
+}
+
+StructuralScanner::StructuralScanner(const char* begin, const char* end, Level level)
+    : m_begin(begin), m_end(end) {
+    if (level > GetBestLevel()) {
+        level = GetBestLevel();
+    }
+    switch (level) {
+    case Level::AVX2:
+        m_classify = ClassifyAVX2;
+        break;
+    case Level::SSE2:
+        m_classify = ClassifySSE2;
+        break;
+    default:
+        m_classify = ClassifyScalar;
+        break;
+    }
+}
+
+size_t StructuralScanner::Next() {
+    while (m_structurals == 0) {
+        if (!LoadBlock()) {
+            return NONE;
+        }
+    }
+    size_t offset = m_blockOffset + TrailingZeros(m_structurals);
+    m_structurals &= m_structurals - 1;
+    return offset;
+}
+
+bool StructuralScanner::LoadBlock() {
+    size_t size = (size_t)(m_end - m_begin);
+    if (m_nextBlock >= size) {
+        return false;
+    }
+
+    // The last partial block is padded with spaces, which are never structural
+    const char* block = m_begin + m_nextBlock;
+    char padded[BLOCK_SIZE];
+    if (size - m_nextBlock < BLOCK_SIZE) {
+        memset(padded, ' ', BLOCK_SIZE);
+        memcpy(padded, block, size - m_nextBlock);
+        block = padded;
+    }
+    Masks masks = m_classify(block);
+
+    // A character is escaped if an odd run of backslashes precedes it. Runs
+    // starting on an odd bit are found by letting the addition carry through
+    // them; the carry out of bit 63 continues a run into the next block.
+    uint64_t backslash = masks.backslash & ~m_escaped;
+    uint64_t followsEscape = (backslash << 1) | m_escaped;
+    uint64_t oddStarts = backslash & ~EVEN_BITS & ~followsEscape;
+    uint64_t sum = oddStarts + backslash;
+    m_escaped = sum < oddStarts ? 1 : 0;
+    uint64_t escaped = (EVEN_BITS ^ (sum << 1)) & followsEscape;
+
+    uint64_t quote = masks.quote & ~escaped;
+    uint64_t inString = PrefixXor(quote) ^ m_inString;
+    m_inString = (uint64_t)((int64_t)inString >> 63);
+
+    m_structurals = (masks.op & ~inString) | quote;
+    m_blockOffset = m_nextBlock;
+    m_nextBlock += BLOCK_SIZE;
+    return true;
+}
+
+StructuralScanner::Masks StructuralScanner::ClassifyScalar(const char* block) {
+    Masks masks = { 0, 0, 0 };
+    for (size_t i = 0; i < BLOCK_SIZE; i++) {
+        uint64_t bit = 1ull << i;
+        switch (block[i]) {
+        case '"':
+            masks.quote |= bit;
+            break;
+        case '\\':
+            masks.backslash |= bit;
+            break;
+        case '{': case '}': case '[': case ']': case ':': case ',':
+            masks.op |= bit;
+            break;
+        default:
+            break;
+        }
+    }
+    return masks;
+}
+
+#ifdef BB_SCANNER_X86
+
+// Setting bit 5 folds '[' onto '{' and ']' onto '}', so brackets take two compares
+
+BB_TARGET_SSE2 StructuralScanner::Masks StructuralScanner::ClassifySSE2(const char* block) {
+    const __m128i quoteChar = _mm_set1_epi8('"');
+    const __m128i backslashChar = _mm_set1_epi8('\\');
+    const __m128i openChar = _mm_set1_epi8('{');
+    const __m128i closeChar = _mm_set1_epi8('}');
+    const __m128i colonChar = _mm_set1_epi8(':');
+    const __m128i commaChar = _mm_set1_epi8(',');
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+
+    Masks masks = { 0, 0, 0 };
+    for (int i = 0; i < 4; i++) {
+        __m128i chunk = _mm_loadu_si128((const __m128i*)(block + i * 16));
+        __m128i folded = _mm_or_si128(chunk, caseBit);
+        __m128i op = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(folded, openChar), _mm_cmpeq_epi8(folded, closeChar)),
+                                  _mm_or_si128(_mm_cmpeq_epi8(chunk, colonChar), _mm_cmpeq_epi8(chunk, commaChar)));
+        int shift = i * 16;
+        masks.quote |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, quoteChar)) << shift;
+        masks.backslash |= (uint64_t)(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, backslashChar)) << shift;
+        masks.op |= (uint64_t)(uint32_t)_mm_movemask_epi8(op) << shift;
+    }
+    return masks;
+}
+
+BB_TARGET_AVX2 StructuralScanner::Masks StructuralScanner::ClassifyAVX2(const char* block) {
+    const __m256i quoteChar = _mm256_set1_epi8('"');
+    const __m256i backslashChar = _mm256_set1_epi8('\\');
+    const __m256i openChar = _mm256_set1_epi8('{');
+    const __m256i closeChar = _mm256_set1_epi8('}');
+    const __m256i colonChar = _mm256_set1_epi8(':');
+    const __m256i commaChar = _mm256_set1_epi8(',');
+    const __m256i caseBit = _mm256_set1_epi8(0x20);
+
+    Masks masks = { 0, 0, 0 };
+    for (int i = 0; i < 2; i++) {
+        __m256i chunk = _mm256_loadu_si256((const __m256i*)(block + i * 32));
+        __m256i folded = _mm256_or_si256(chunk, caseBit);
+        __m256i op = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(folded, openChar), _mm256_cmpeq_epi8(folded, closeChar)),
+            _mm256_or_si256(_mm256_cmpeq_epi8(chunk, colonChar), _mm256_cmpeq_epi8(chunk, commaChar)));
+        int shift = i * 32;
+        masks.quote |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, quoteChar)) << shift;
+        masks.backslash |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, backslashChar)) << shift;
+        masks.op |= (uint64_t)(uint32_t)_mm256_movemask_epi8(op) << shift;
+    }
+    return masks;
+}
+
+#else
+
+StructuralScanner::Masks StructuralScanner::ClassifySSE2(const char* block) {
+    return ClassifyScalar(block);
+}
+
+StructuralScanner::Masks StructuralScanner::ClassifyAVX2(const char* block) {
+    return ClassifyScalar(block);
+}
+
+#endif
+
+} // namespace viewer
+} // namespace bigbrother
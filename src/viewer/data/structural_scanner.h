@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace bigbrother {
+namespace viewer {
+
+/**
+ * @brief Finds the structural characters of a JSON text, 64 bytes at a time
+ *
+ * Stage one of a simdjson-style parse. Each block is classified with vector
+ * compares into bitmasks (quotes, backslashes, brackets, colons, commas);
+ * escaped quotes and the inside of strings are then removed with plain
+ * 64-bit arithmetic, carrying string and escape state across blocks.
+ *
+ * Reported positions are every `{ } [ ] : ,` outside a string plus both
+ * quotes of every string, so a string's contents lie between two
+ * consecutive positions. Scalars (numbers, true, false, null) are not
+ * reported; they are whatever lies between two structurals. Nothing is
+ * validated here.
+ */
+class StructuralScanner {
+public:
+    static constexpr size_t BLOCK_SIZE = 64;
+    static constexpr size_t NONE = (size_t)-1;
+
+    /**
+     * @brief Instruction set used to classify blocks
+     */
+    enum class Level {
+        Scalar,
+        SSE2,
+        AVX2
+    };
+
+    /**
+     * @brief Best level this CPU supports (detected once)
+     */
+    static Level GetBestLevel();
+
+    /**
+     * @param begin Start of the text; must not be inside a string
+     * @param end One past its last byte
+     * @param level Classifier to use; levels the CPU lacks fall back to Scalar
+     */
+    StructuralScanner(const char* begin, const char* end, Level level = GetBestLevel());
+
+    /**
+     * @brief Offset from `begin` of the next structural character
+     * @return NONE once the text is exhausted
+     */
+    size_t Next();
+
+    /**
+     * @brief True if the text scanned so far ends inside a string
+     */
+    bool InString() const { return m_inString != 0; }
+
+private:
+    struct Masks {
+        uint64_t quote;
+        uint64_t backslash;
+        uint64_t op;        // { } [ ] : ,
+    };
+
+    typedef Masks (*ClassifyFn)(const char* block);
+
+    const char* m_begin;
+    const char* m_end;
+    ClassifyFn m_classify;
+
+    size_t m_blockOffset = 0;      // Offset of the block m_structurals belongs to
+    size_t m_nextBlock = 0;        // Offset of the next block to classify
+    uint64_t m_structurals = 0;    // Unreported structurals in the current block
+    uint64_t m_inString = 0;       // All ones if the previous block ended inside a string
+    uint64_t m_escaped = 0;        // 1 if the previous block ended with an odd run of backslashes
+
+    bool LoadBlock();
+
+    static Masks ClassifyScalar(const char* block);
+    static Masks ClassifySSE2(const char* block);
+    static Masks ClassifyAVX2(const char* block);
+};
+
+} // namespace viewer
+} // namespace bigbrother
@@ -0,0 +1,157 @@
+#include "icon_atlas.h"
+#include <cstring>
+
+// Dear ImGui compiles its copy of stb_rect_pack as static, so this file has its own
+#define STBRP_STATIC
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "imstb_rectpack.h"
+
+namespace bigbrother {
+namespace viewer {
+
+IconAtlas::Page::~Page() {
+    if (view) view->Release();
+    if (texture) texture->Release();
+}
+
+IconAtlas::IconAtlas(ID3D11Device* device)
+    : m_device(device)
+{
+    m_device->GetImmediateContext(&m_context);
+}
+
+IconAtlas::~IconAtlas() {
+    Clear();
+    if (m_context) {
+        m_context->Release();
+    }
+}
+
+bool IconAtlas::Allocate(int width, int height, Slot& slot) {
+    if (width <= 0 || height <= 0 || width + PADDING > PAGE_SIZE || height + PADDING > PAGE_SIZE) {
+        return false;
+    }
+    
+    // Room left by evicted icons first, then fresh space, then a new page
+    if (ReuseFreeSlot(width, height, slot)) {
+        return true;
+    }
+    for (size_t i = 0; i <= m_pages.size(); i++) {
+        if (i == m_pages.size() && !AddPage()) {
+            return false;
+        }
+        stbrp_rect rect = {};
+        rect.w = width + PADDING;
+        rect.h = height + PADDING;
+        if (stbrp_pack_rects(m_pages[i]->packer.get(), &rect, 1) && rect.was_packed) {
+            slot.page = (int)i;
+            slot.x = rect.x;
+            slot.y = rect.y;
+            slot.width = width;
+            slot.height = height;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool IconAtlas::ReuseFreeSlot(int width, int height, Slot& slot) {
+    // Smallest free slot the icon fits in; icons are mostly one size, so this is usually exact
+    Page* bestPage = nullptr;
+    size_t bestIndex = 0;
+    int bestArea = 0;
+    for (auto& page : m_pages) {
+        for (size_t i = 0; i < page->freeSlots.size(); i++) {
+            const Slot& candidate = page->freeSlots[i];
+            int area = candidate.width * candidate.height;
+            if (candidate.width >= width && candidate.height >= height && (!bestPage || area < bestArea)) {
+                bestPage = page.get();
+                bestIndex = i;
+                bestArea = area;
+            }
+        }
+    }
+    if (!bestPage) {
+        return false;
+    }
+    slot = bestPage->freeSlots[bestIndex];
+    bestPage->freeSlots[bestIndex] = bestPage->freeSlots.back();
+    bestPage->freeSlots.pop_back();
+    return true;
+}
+
+bool IconAtlas::AddPage() {
+    if ((int)m_pages.size() >= MAX_PAGES) {
+        return false;
+    }
+    
+    // Start transparent so padding and reused slots never show old pixels
+    std::vector<unsigned char> clear((size_t)PAGE_SIZE * PAGE_SIZE * 4, 0);
+    
+    D3D11_TEXTURE2D_DESC desc = {};
+    desc.Width = PAGE_SIZE;
+    desc.Height = PAGE_SIZE;
+    desc.MipLevels = 1;
+    desc.ArraySize = 1;
+    desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+    desc.SampleDesc.Count = 1;
+    desc.Usage = D3D11_USAGE_DEFAULT;
+    desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+    
+    D3D11_SUBRESOURCE_DATA initData = {};
+    initData.pSysMem = clear.data();
+    initData.SysMemPitch = PAGE_SIZE * 4;
+    
+    auto page = std::make_unique<Page>();
+    if (FAILED(m_device->CreateTexture2D(&desc, &initData, &page->texture))) {
+        return false;
+    }
+    
+    D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Format = desc.Format;
+    srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+    srvDesc.Texture2D.MipLevels = 1;
+    if (FAILED(m_device->CreateShaderResourceView(page->texture, &srvDesc, &page->view))) {
+        return false;
+    }
+    
+    page->packer = std::make_unique<stbrp_context>();
+    page->nodes.resize(PAGE_SIZE);
+    stbrp_init_target(page->packer.get(), PAGE_SIZE, PAGE_SIZE, page->nodes.data(), (int)page->nodes.size());
+    m_pages.push_back(std::move(page));
+    return true;
+}
+
+void IconAtlas::Free(const Slot& slot) {
+    if (slot.IsValid() && slot.page < (int)m_pages.size()) {
+        m_pages[slot.page]->freeSlots.push_back(slot);
+    }
+}
+
+void IconAtlas::Upload(const Slot& slot, const unsigned char* rgba, int width, int height) {
+    if (!slot.IsValid() || width > slot.width || height > slot.height) {
+        return;
+    }
+    
+    // The whole slot is written, so a smaller icon in a reused slot leaves no remains
+    std::vector<unsigned char> pixels((size_t)slot.width * slot.height * 4, 0);
+    for (int y = 0; y < height; y++) {
+        memcpy(&pixels[(size_t)y * slot.width * 4], rgba + (size_t)y * width * 4, (size_t)width * 4);
+    }
+    
+    D3D11_BOX box = {};
+    box.left = slot.x;
+    box.top = slot.y;
+    box.right = slot.x + slot.width;
+    box.bottom = slot.y + slot.height;
+    box.front = 0;
+    box.back = 1;
+    m_context->UpdateSubresource(m_pages[slot.page]->texture, 0, &box, pixels.data(), slot.width * 4, 0);
+}
+
+void IconAtlas::Clear() {
+    m_pages.clear();
+}
+
+} // namespace viewer
+} // namespace bigbrother
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <d3d11.h>
+#include <memory>
+#include <vector>
+
+struct stbrp_context;
+struct stbrp_node;
+
+namespace bigbrother {
+namespace viewer {
+
+/**
+ * @brief A few large textures that small icons are packed into
+ * 
+ * New icons are placed with stb_rect_pack; slots given back with Free are
+ * reused by later icons that fit in them, so the atlas never needs
+ * repacking. Drawing many icons from one page keeps texture switches out
+ * of the timeline's draw list.
+ */
+class IconAtlas {
+public:
+    /** @brief Width and height of each page in pixels */
+    static constexpr int PAGE_SIZE = 512;
+
+    /** @brief Pages created at most (1 MB each) */
+    static constexpr int MAX_PAGES = 4;
+
+    /**
+     * @brief Place of one icon in the atlas
+     */
+    struct Slot {
+        int page = -1;
+        int x = 0;
+        int y = 0;
+        int width = 0;      // Space reserved, which can exceed the icon it holds
+        int height = 0;
+
+        bool IsValid() const { return page >= 0; }
+    };
+
+    explicit IconAtlas(ID3D11Device* device);
+    ~IconAtlas();
+    IconAtlas(const IconAtlas&) = delete;
+    IconAtlas& operator=(const IconAtlas&) = delete;
+
+    /**
+     * @brief Reserve room for a `width` x `height` icon
+     * @return false if every page is full; free a slot and retry
+     */
+    bool Allocate(int width, int height, Slot& slot);
+
+    /**
+     * @brief Give a slot back for reuse
+     */
+    void Free(const Slot& slot);
+
+    /**
+     * @brief Copy RGBA pixels into the top-left corner of a slot
+     */
+    void Upload(const Slot& slot, const unsigned char* rgba, int width, int height);
+
+    ID3D11ShaderResourceView* GetTexture(int page) const { return m_pages[page]->view; }
+
+    /**
+     * @brief Release all pages
+     */
+    void Clear();
+
+private:
+    struct Page {
+        ID3D11ShaderResourceView* view = nullptr;
+        ID3D11Texture2D* texture = nullptr;
+        std::unique_ptr<stbrp_context> packer;
+        std::vector<stbrp_node> nodes;
+        std::vector<Slot> freeSlots;
+
+        ~Page();
+    };
+
+    // Transparent gap around each icon so filtering never samples a neighbour
+    static constexpr int PADDING = 1;
+
+    ID3D11Device* m_device;
+    ID3D11DeviceContext* m_context = nullptr;
+    std::vector<std::unique_ptr<Page>> m_pages;
+
+    bool ReuseFreeSlot(int width, int height, Slot& slot);
+    bool AddPage();
+};
+
+} // namespace viewer
+} // namespace bigbrother
@@ -1,34 +1,177 @@
 #include "icon_manager.h"
 #include <windows.h>
+#include <objbase.h>
 #include <shellapi.h>
 
 namespace bigbrother {
 namespace viewer {
 
 IconManager::IconManager(ID3D11Device* device)
-    : m_device(device)
+    : m_atlas(device)
 {
 }
 
 IconManager::~IconManager() {
+    StopWorker();
     ClearCache();
 }
 
-ID3D11ShaderResourceView* IconManager::GetIcon(const std::string& exePath) {
+void IconManager::StopWorker() {
+    if (!m_worker.joinable()) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wake.notify_one();
+    m_worker.join();
+}
+
+IconManager::Icon IconManager::GetIcon(const std::string& exePath) {
     // Check cache first
-    auto it = m_iconCache.find(exePath);
-    if (it != m_iconCache.end()) {
-        return it->second;
+    auto it = m_lookup.find(exePath);
+    if (it != m_lookup.end()) {
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        return MakeIcon(*it->second);
     }
     
-    // Limit cache size to prevent memory issues
-    const size_t maxCacheSize = 200;
-    if (m_iconCache.size() >= maxCacheSize) {
-        // Cache is full, return null (or could implement LRU eviction)
-        return nullptr;
+    // Remember the request (the result is cached even without an icon,
+    // to avoid repeated failures) and let the worker extract it
+    Entry entry;
+    entry.exePath = exePath;
+    m_entries.push_front(std::move(entry));
+    m_lookup[exePath] = m_entries.begin();
+    while (m_entries.size() > MAX_ENTRIES) {
+        EvictOldest();
     }
+    RequestIcon(exePath);
     
-    ID3D11ShaderResourceView* texture = nullptr;
+    return MakeIcon(m_entries.front());
+}
+
+void IconManager::RequestIcon(const std::string& exePath) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requests.push_back(exePath);
+        if (!m_worker.joinable()) {
+            m_stop = false;
+            m_worker = std::thread(&IconManager::WorkerLoop, this);
+        }
+    }
+    m_wake.notify_one();
+}
+
+void IconManager::WorkerLoop() {
+    // The shell functions behind SHGetFileInfo expect COM on the calling thread
+    HRESULT comResult = CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED);
+    
+    for (;;) {
+        LoadedIcon icon;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this]() { return m_stop || !m_requests.empty(); });
+            if (m_stop) {
+                break;
+            }
+            icon.exePath = std::move(m_requests.front());
+            m_requests.pop_front();
+        }
+        
+        icon.loaded = LoadIconPixels(icon.exePath, icon.rgba, icon.width, icon.height);
+        
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_loaded.push_back(std::move(icon));
+        }
+        if (m_readyCallback) {
+            m_readyCallback();
+        }
+    }
+    
+    if (SUCCEEDED(comResult)) {
+        CoUninitialize();
+    }
+}
+
+void IconManager::UploadPending(size_t maxUploads) {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        while (!m_loaded.empty() && m_uploads.size() < maxUploads) {
+            m_uploads.push_back(std::move(m_loaded.front()));
+            m_loaded.pop_front();
+        }
+    }
+    
+    for (LoadedIcon& icon : m_uploads) {
+        // Evicted while the worker was busy, or already filled by an earlier request
+        auto it = m_lookup.find(icon.exePath);
+        if (it == m_lookup.end() || !it->second->pending) {
+            continue;
+        }
+        
+        // Most recent first, so making room never evicts the entry being filled
+        m_entries.splice(m_entries.begin(), m_entries, it->second);
+        Entry& entry = *it->second;
+        entry.pending = false;
+        if (icon.loaded && AllocateSlot(icon.width, icon.height, entry.slot)) {
+            m_atlas.Upload(entry.slot, icon.rgba.data(), icon.width, icon.height);
+            entry.width = icon.width;
+            entry.height = icon.height;
+        }
+    }
+    m_uploads.clear();
+}
+
+bool IconManager::HasPendingUploads() const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return !m_loaded.empty();
+}
+
+void IconManager::ClearCache() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requests.clear();
+        m_loaded.clear();
+    }
+    m_lookup.clear();
+    m_entries.clear();
+    m_atlas.Clear();
+}
+
+IconManager::Icon IconManager::MakeIcon(const Entry& entry) const {
+    Icon icon;
+    icon.pending = entry.pending;
+    if (entry.slot.IsValid()) {
+        const float scale = 1.0f / IconAtlas::PAGE_SIZE;
+        icon.texture = m_atlas.GetTexture(entry.slot.page);
+        icon.u0 = entry.slot.x * scale;
+        icon.v0 = entry.slot.y * scale;
+        icon.u1 = (entry.slot.x + entry.width) * scale;
+        icon.v1 = (entry.slot.y + entry.height) * scale;
+    }
+    return icon;
+}
+
+bool IconManager::AllocateSlot(int width, int height, IconAtlas::Slot& slot) {
+    while (!m_atlas.Allocate(width, height, slot)) {
+        if (m_entries.size() <= 1) {
+            return false;
+        }
+        EvictOldest();
+    }
+    return true;
+}
+
+void IconManager::EvictOldest() {
+    const Entry& oldest = m_entries.back();
+    m_atlas.Free(oldest.slot);
+    m_lookup.erase(oldest.exePath);
+    m_entries.pop_back();
+}
+
+bool IconManager::LoadIconPixels(const std::string& exePath, std::vector<unsigned char>& rgba, int& width, int& height) {
+    bool loaded = false;
     
     try {
         // Extract icon from executable
@@ -49,42 +192,32 @@ ID3D11ShaderResourceView* IconManager::GetIcon(const std::string& exePath) {
         }
         
         if (hIcon) {
-            texture = CreateTextureFromIcon(hIcon);
+            loaded = ReadIconPixels(hIcon, rgba, width, height);
             DestroyIcon(hIcon);
         }
     } catch (...) {
         // Silently fail on icon extraction errors
-        texture = nullptr;
+        loaded = false;
     }
     
-    // Cache the result (even if null, to avoid repeated failures)
-    m_iconCache[exePath] = texture;
-    
-    return texture;
-}
-
-void IconManager::ClearCache() {
-    for (auto& pair : m_iconCache) {
-        if (pair.second) {
-            pair.second->Release();
-        }
-    }
-    m_iconCache.clear();
+    return loaded;
 }
 
-ID3D11ShaderResourceView* IconManager::CreateTextureFromIcon(HICON hIcon) {
-    if (!hIcon) return nullptr;
+bool IconManager::ReadIconPixels(HICON hIcon, std::vector<unsigned char>& rgba, int& width, int& height) {
+    if (!hIcon) return false;
     
     ICONINFO iconInfo;
     if (!GetIconInfo(hIcon, &iconInfo)) {
-        return nullptr;
+        return false;
     }
     
-    BITMAP bmp;
-    GetObject(iconInfo.hbmColor, sizeof(BITMAP), &bmp);
+    BITMAP bmp = {};
+    GetObject(iconInfo.hbmColor ? iconInfo.hbmColor : iconInfo.hbmMask, sizeof(BITMAP), &bmp);
+    
+    width = bmp.bmWidth;
+    height = iconInfo.hbmColor ? bmp.bmHeight : bmp.bmHeight / 2; // Monochrome masks stack AND over XOR
     
-    int width = bmp.bmWidth;
-    int height = bmp.bmHeight;
+    bool loaded = false;
     
     // Create a DIB section to get the icon bitmap data
     BITMAPINFO bmi = {};
@@ -97,7 +230,7 @@ ID3D11ShaderResourceView* IconManager::CreateTextureFromIcon(HICON hIcon) {
     
     void* bits = nullptr;
     HDC hdc = GetDC(NULL);
-    HBITMAP hDIB = CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, &bits, NULL, 0);
+    HBITMAP hDIB = width > 0 && height > 0 ? CreateDIBSection(hdc, &bmi, DIB_RGB_COLORS, &bits, NULL, 0) : NULL;
     
     if (hDIB && bits) {
         HDC hdcMem = CreateCompatibleDC(hdc);
@@ -110,57 +243,31 @@ ID3D11ShaderResourceView* IconManager::CreateTextureFromIcon(HICON hIcon) {
         DeleteDC(hdcMem);
         
         // Convert BGRA to RGBA (Windows uses BGRA, DirectX expects RGBA)
-        unsigned char* pixels = (unsigned char*)bits;
-        int totalPixels = width * height;
-        for (int i = 0; i < totalPixels; i++) {
-            int idx = i * 4;
-            unsigned char b = pixels[idx + 0];
-            unsigned char r = pixels[idx + 2];
-            pixels[idx + 0] = r;  // Red
-            pixels[idx + 2] = b;  // Blue
-            // Green (idx+1) and Alpha (idx+3) stay the same
-        }
-        
-        // Create DirectX texture
-        D3D11_TEXTURE2D_DESC desc = {};
-        desc.Width = width;
-        desc.Height = height;
-        desc.MipLevels = 1;
-        desc.ArraySize = 1;
-        desc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
-        desc.SampleDesc.Count = 1;
-        desc.Usage = D3D11_USAGE_DEFAULT;
-        desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-        
-        D3D11_SUBRESOURCE_DATA initData = {};
-        initData.pSysMem = bits;
-        initData.SysMemPitch = width * 4;
-        
-        ID3D11Texture2D* pTexture = nullptr;
-        HRESULT hr = m_device->CreateTexture2D(&desc, &initData, &pTexture);
-        
-        ID3D11ShaderResourceView* pSRV = nullptr;
-        if (SUCCEEDED(hr)) {
-            D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-            srvDesc.Format = desc.Format;
-            srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-            srvDesc.Texture2D.MipLevels = 1;
-            
-            hr = m_device->CreateShaderResourceView(pTexture, &srvDesc, &pSRV);
-            pTexture->Release();
+        const unsigned char* pixels = (const unsigned char*)bits;
+        size_t totalPixels = (size_t)width * height;
+        rgba.resize(totalPixels * 4);
+        for (size_t i = 0; i < totalPixels; i++) {
+            size_t idx = i * 4;
+            rgba[idx + 0] = pixels[idx + 2];  // Red
+            rgba[idx + 1] = pixels[idx + 1];  // Green
+            rgba[idx + 2] = pixels[idx + 0];  // Blue
+            rgba[idx + 3] = pixels[idx + 3];  // Alpha
         }
-        
-        DeleteObject(hDIB);
-        ReleaseDC(NULL, hdc);
-        
-        return pSRV;
+        loaded = true;
     }
     
+    if (hDIB) {
+        DeleteObject(hDIB);
+    }
     ReleaseDC(NULL, hdc);
-    DeleteObject(iconInfo.hbmColor);
-    DeleteObject(iconInfo.hbmMask);
+    if (iconInfo.hbmColor) {
+        DeleteObject(iconInfo.hbmColor);
+    }
+    if (iconInfo.hbmMask) {
+        DeleteObject(iconInfo.hbmMask);
+    }
     
-    return nullptr;
+    return loaded;
 }
 
 } // namespace viewer
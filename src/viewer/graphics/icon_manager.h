@@ -1,8 +1,16 @@
 #pragma once
 
 #include <d3d11.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <mutex>
 #include <string>
-#include <map>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include "icon_atlas.h"
 
 namespace bigbrother {
 namespace viewer {
@@ -10,20 +18,69 @@ namespace viewer {
 /**
  * @brief Manages application icons
  * 
- * Extracts icons from executable files, converts them to DirectX textures,
- * and caches them for efficient reuse.
+ * Extracts icons from executable files and packs them into a shared
+ * IconAtlas. The least recently used icons give their atlas slots to new
+ * ones, so any number of programs can be shown.
+ * 
+ * Extraction (shell calls, GDI drawing, pixel conversion) runs on a worker
+ * thread, so slow or network paths never stall a frame. GetIcon reports a
+ * pending icon until UploadPending copies the pixels into the atlas on the
+ * render thread, a few icons per frame.
  */
 class IconManager {
 public:
+    /** @brief Executables remembered at most, with or without an icon */
+    static constexpr size_t MAX_ENTRIES = 4096;
+
+    /** @brief Icons copied into the atlas per UploadPending call */
+    static constexpr size_t UPLOADS_PER_FRAME = 8;
+
+    /**
+     * @brief Where to draw an icon from
+     */
+    struct Icon {
+        ID3D11ShaderResourceView* texture = nullptr;   ///< Atlas page; null if there is no icon
+        float u0 = 0.0f;
+        float v0 = 0.0f;
+        float u1 = 0.0f;
+        float v1 = 0.0f;
+        bool pending = false;                          ///< Still being extracted; draw a placeholder
+    };
+
     IconManager(ID3D11Device* device);
     ~IconManager();
 
     /**
-     * @brief Get icon texture for an executable
+     * @brief Function called on the worker thread when an icon is ready to upload
+     *
+     * Lets a frame loop that sleeps between events wake up. Must be set
+     * before the first GetIcon.
+     */
+    void SetReadyCallback(std::function<void()> callback) { m_readyCallback = std::move(callback); }
+
+    /**
+     * @brief Get the icon of an executable
      * @param exePath Full path to executable file
-     * @return DirectX texture, or nullptr if icon couldn't be loaded
+     * @return Atlas texture and UV rectangle; texture is null if the icon couldn't be loaded
+     *         or is still pending
+     */
+    Icon GetIcon(const std::string& exePath);
+
+    /**
+     * @brief Copy extracted icons into the atlas; call once per frame on the render thread
+     * @param maxUploads Upload budget for this frame
      */
-    ID3D11ShaderResourceView* GetIcon(const std::string& exePath);
+    void UploadPending(size_t maxUploads = UPLOADS_PER_FRAME);
+
+    /**
+     * @brief True if extracted icons are waiting for UploadPending
+     */
+    bool HasPendingUploads() const;
+
+    /**
+     * @brief Stop the worker; an extraction in progress is finished first
+     */
+    void StopWorker();
 
     /**
      * @brief Clear all cached icons and free memory
@@ -31,11 +88,51 @@ public:
     void ClearCache();
 
 private:
-    ID3D11Device* m_device;
-    std::map<std::string, ID3D11ShaderResourceView*> m_iconCache;
+    struct Entry {
+        std::string exePath;
+        IconAtlas::Slot slot;       // Invalid if the executable has no icon
+        int width = 0;
+        int height = 0;
+        bool pending = true;        // Queued for the worker
+    };
+
+    /**
+     * @brief Worker output waiting for upload
+     */
+    struct LoadedIcon {
+        std::string exePath;
+        std::vector<unsigned char> rgba;
+        int width = 0;
+        int height = 0;
+        bool loaded = false;
+    };
+
+    // Render thread only
+    IconAtlas m_atlas;
+    std::list<Entry> m_entries;     // Most recently used first
+    std::unordered_map<std::string, std::list<Entry>::iterator> m_lookup;
+    std::vector<LoadedIcon> m_uploads;
+
+    // Shared with the worker, guarded by m_mutex
+    std::thread m_worker;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::deque<std::string> m_requests;
+    std::deque<LoadedIcon> m_loaded;
+    bool m_stop = false;
+    std::function<void()> m_readyCallback;
+
+    Icon MakeIcon(const Entry& entry) const;
+    void RequestIcon(const std::string& exePath);
+    void WorkerLoop();
+
+    // Evict least recently used icons, except the most recent one, until the atlas has room
+    bool AllocateSlot(int width, int height, IconAtlas::Slot& slot);
+    void EvictOldest();
 
-    // Convert Windows HICON to DirectX texture
-    ID3D11ShaderResourceView* CreateTextureFromIcon(HICON hIcon);
+    // Extract an executable's small icon as RGBA pixels
+    static bool LoadIconPixels(const std::string& exePath, std::vector<unsigned char>& rgba, int& width, int& height);
+    static bool ReadIconPixels(HICON hIcon, std::vector<unsigned char>& rgba, int& width, int& height);
 };
 
 } // namespace viewer
@@ -10,6 +10,13 @@ static ID3D11Device*            g_pd3dDevice = nullptr;
 static ID3D11DeviceContext*     g_pd3dDeviceContext = nullptr;
 static IDXGISwapChain*          g_pSwapChain = nullptr;
 static ID3D11RenderTargetView*  g_mainRenderTargetView = nullptr;
+static bool                     g_swapChainOccluded = false;
+static bool                     g_windowMessageHandled = false;
+
+// Frames rendered after each event, so ImGui can settle (popups size themselves on their second frame)
+static const int                FRAMES_AFTER_EVENT = 3;
+// Minimum interval between frames while minimized or occluded
+static const ULONGLONG          THROTTLED_FRAME_MS = 250;
 
 // Forward declarations
 bool CreateDeviceD3D(HWND hWnd);
@@ -54,14 +61,54 @@ int main(int, char**)
     // Create main window manager
     bigbrother::viewer::MainWindow mainWindow(g_pd3dDevice);
 
-    // Main loop
+    // Main loop: frames are only rendered for input, new data or animation
     bool done = false;
+    int framesToRender = FRAMES_AFTER_EVENT;
+    ULONGLONG lastFrameTime = 0;
     while (!done)
     {
-        // Poll and handle messages
+        // While throttled, frames are due THROTTLED_FRAME_MS apart
+        DWORD untilNextFrame = 0;
+        if (g_swapChainOccluded || ::IsIconic(hwnd))
+        {
+            ULONGLONG elapsed = ::GetTickCount64() - lastFrameTime;
+            if (elapsed < THROTTLED_FRAME_MS)
+                untilNextFrame = (DWORD)(THROTTLED_FRAME_MS - elapsed);
+        }
+
+        // Sleep until a message, a data notification or the next frame deadline.
+        // With a frame already owed only messages are waited on: the file
+        // watcher stays signaled until it is read.
+        HANDLE handles[bigbrother::viewer::MainWindow::MAX_WAIT_HANDLES];
+        DWORD handleCount = 0;
+        DWORD timeout = untilNextFrame;
+        if (framesToRender == 0)
+        {
+            handleCount = (DWORD)mainWindow.GetWaitHandles(handles, bigbrother::viewer::MainWindow::MAX_WAIT_HANDLES);
+            timeout = mainWindow.GetFrameTimeout();
+            if (timeout != INFINITE && timeout < untilNextFrame)
+                timeout = untilNextFrame;
+        }
+        DWORD waitResult = ::MsgWaitForMultipleObjectsEx(handleCount, handles, timeout, QS_ALLINPUT, MWMO_INPUTAVAILABLE);
+        if (waitResult == WAIT_TIMEOUT)
+            framesToRender = framesToRender > 0 ? framesToRender : 1;
+        else if (waitResult - WAIT_OBJECT_0 < handleCount)
+        {
+            if (mainWindow.OnWaitHandleSignaled(handles[waitResult - WAIT_OBJECT_0]))
+                framesToRender = FRAMES_AFTER_EVENT;
+        }
+        else if (waitResult != WAIT_OBJECT_0 + handleCount)
+            framesToRender = FRAMES_AFTER_EVENT;
+
+        // Poll and handle messages. WinEvent hooks (the viewer's own session
+        // recording) are called from PeekMessage without a message for the
+        // window, so system-wide focus changes do not cost a frame.
+        bool gotMessage = false;
+        g_windowMessageHandled = false;
         MSG msg;
         while (::PeekMessage(&msg, nullptr, 0U, 0U, PM_REMOVE))
         {
+            gotMessage = true;
             ::TranslateMessage(&msg);
             ::DispatchMessage(&msg);
             if (msg.message == WM_QUIT)
@@ -69,6 +116,16 @@ int main(int, char**)
         }
         if (done)
             break;
+        if (gotMessage || g_windowMessageHandled)
+            framesToRender = FRAMES_AFTER_EVENT;
+        if (framesToRender <= 0)
+            continue;
+
+        // A throttled window keeps its events until the next frame is due
+        if ((g_swapChainOccluded || ::IsIconic(hwnd)) && ::GetTickCount64() - lastFrameTime < THROTTLED_FRAME_MS)
+            continue;
+        framesToRender--;
+        lastFrameTime = ::GetTickCount64();
 
         // Start the Dear ImGui frame
         ImGui_ImplDX11_NewFrame();
@@ -85,7 +142,8 @@ int main(int, char**)
         g_pd3dDeviceContext->ClearRenderTargetView(g_mainRenderTargetView, clear_color_with_alpha);
         ImGui_ImplDX11_RenderDrawData(ImGui::GetDrawData());
 
-        g_pSwapChain->Present(1, 0);
+        HRESULT hr = g_pSwapChain->Present(1, 0);
+        g_swapChainOccluded = (hr == DXGI_STATUS_OCCLUDED);
     }
 
     // Cleanup
@@ -159,6 +217,9 @@ extern IMGUI_IMPL_API LRESULT ImGui_ImplWin32_WndProcHandler(HWND hWnd, UINT msg
 // Win32 message handler
 LRESULT WINAPI WndProc(HWND hWnd, UINT msg, WPARAM wParam, LPARAM lParam)
 {
+    // Sent messages (resizing, activation) reach here without PeekMessage returning them
+    g_windowMessageHandled = true;
+
     if (ImGui_ImplWin32_WndProcHandler(hWnd, msg, wParam, lParam))
         return true;
 
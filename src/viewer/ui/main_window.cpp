@@ -10,9 +10,16 @@ MainWindow::MainWindow(ID3D11Device* device)
     , m_settingsWindow(m_filterManager)
     , m_timelineView(m_iconManager, m_filterManager)
 {
-    // Load initial data
-    m_dataFilePath = m_sessionLoader.GetDefaultDataPath();
-    ReloadSessions();
+    // Load initial data in the background; the worker wakes the frame loop
+    m_updateEvent = CreateEventA(nullptr, FALSE, FALSE, nullptr);
+    m_loader.SetUpdateCallback([this]() {
+        SetEvent(m_updateEvent);
+    });
+    m_iconManager.SetReadyCallback([this]() {
+        SetEvent(m_updateEvent);
+    });
+    m_dataFilePath = SessionLoader().GetDefaultDataPath();
+    m_loader.Start(m_dataFilePath, LoadMode::Full);
     
     // Set up file watcher for event-based updates
     SetupFileWatcher();
@@ -25,18 +32,59 @@ MainWindow::MainWindow(ID3D11Device* device)
 
 MainWindow::~MainWindow() {
     CleanupFileWatcher();
+    m_loader.Stop();
+    m_iconManager.StopWorker();
+    if (m_updateEvent) {
+        CloseHandle(m_updateEvent);
+    }
 }
 
-void MainWindow::Render() {
-    // Check file watcher for changes
-    if (m_fileWatcherEnabled) {
-        CheckFileWatcher();
-        
-        // Reload if file changed
-        if (m_shouldReload) {
+size_t MainWindow::GetWaitHandles(HANDLE* handles, size_t capacity) const {
+    size_t count = 0;
+    if (m_updateEvent && count < capacity) {
+        handles[count++] = m_updateEvent;
+    }
+    if (m_fileWatcherEnabled && m_fileWatcherHandle != INVALID_HANDLE_VALUE && count < capacity) {
+        handles[count++] = m_fileWatcherHandle;
+    }
+    return count;
+}
+
+bool MainWindow::OnWaitHandleSignaled(HANDLE handle) {
+    // File changes only need a frame once the loader publishes something
+    // new, which signals the update event
+    if (handle == m_fileWatcherHandle) {
+        if (m_fileWatcherEnabled && CheckFileWatcher()) {
             ReloadSessions();
-            m_shouldReload = false;
         }
+        return false;
+    }
+    return true;
+}
+
+DWORD MainWindow::GetFrameTimeout() const {
+    if (m_iconManager.HasPendingUploads()) {
+        return 0;
+    }
+    if (m_loader.IsLoading()) {
+        return LOADING_FRAME_MS;
+    }
+    if (ImGui::GetIO().WantTextInput) {
+        return TEXT_INPUT_FRAME_MS;
+    }
+    return INFINITE;
+}
+
+void MainWindow::Render() {
+    // Pick up whatever the loader published since the last frame
+    m_snapshot = m_loader.GetSnapshot();
+    
+    // Icons extracted since the last frame, within the upload budget
+    m_iconManager.UploadPending();
+    
+    // Check file watcher for changes
+    if (m_fileWatcherEnabled && CheckFileWatcher()) {
+        ReloadSessions();
     }
     
     // Get IO for window sizing
@@ -52,7 +100,11 @@ void MainWindow::Render() {
     RenderMenuBar();
     
     // Timeline view
-    m_timelineView.Render(m_sessions);
+    if (m_snapshot) {
+        m_timelineView.Render(*m_snapshot);
+    } else {
+        ImGui::TextDisabled("Loading sessions...");
+    }
 
     ImGui::End();
 
@@ -67,13 +119,8 @@ void MainWindow::Render() {
 }
 
 void MainWindow::ReloadSessions() {
-    try {
-        m_sessions = m_sessionLoader.LoadFromFile(m_dataFilePath);
-    } catch (const std::exception& e) {
-        // If loading fails, clear sessions to prevent crashes
-        m_sessions.clear();
-        // TODO: Show error message to user
-    }
+    // Only files that changed since the last load are read again
+    m_loader.RequestRefresh();
 }
 
 void MainWindow::RenderMenuBar() {
@@ -84,7 +131,21 @@ void MainWindow::RenderMenuBar() {
         
         if (ImGui::Button("Reload"))
         {
-            ReloadSessions();
+            m_loader.RequestFullReload();
+        }
+        
+        RenderLoadProgress();
+        
+        // Older days are only read on request (LoadMode::Lazy)
+        size_t unloaded = m_snapshot ? m_snapshot->GetUnloadedSegmentCount() : 0;
+        if (unloaded > 0)
+        {
+            ImGui::SameLine();
+            std::string label = "Load earlier (" + std::to_string(unloaded) + " more)";
+            if (ImGui::Button(label.c_str()))
+            {
+                m_loader.RequestLoadEarlier(SessionLoader::DEFAULT_LAZY_SEGMENTS);
+            }
         }
         
         ImGui::SameLine();
@@ -147,20 +208,32 @@ void MainWindow::RenderMenuBar() {
     }
 }
 
+void MainWindow::RenderLoadProgress() {
+    float fraction = 0.0f;
+    if (m_loader.GetProgress(fraction)) {
+        ImGui::SameLine();
+        ImGui::ProgressBar(fraction, ImVec2(120, 0), "Loading...");
+    }
+}
+
 void MainWindow::RequestDeleteSession(int sessionIndex) {
+    m_deleteSnapshot = m_snapshot;
     m_deleteSessionIndex = sessionIndex;
     m_showDeleteConfirmation = true;
 }
 
 void MainWindow::RenderDeleteConfirmation() {
-    if (!m_showDeleteConfirmation) return;
+    if (!m_showDeleteConfirmation) {
+        m_deleteSnapshot.reset();
+        return;
+    }
     
-    if (m_deleteSessionIndex < 0 || m_deleteSessionIndex >= m_sessions.size()) {
+    if (!m_deleteSnapshot || m_deleteSessionIndex < 0 || m_deleteSessionIndex >= m_deleteSnapshot->size()) {
         m_showDeleteConfirmation = false;
         return;
     }
     
-    const auto& session = m_sessions[m_deleteSessionIndex];
+    const auto& session = (*m_deleteSnapshot)[m_deleteSessionIndex];
     
     ImGui::OpenPopup("Delete Session?");
     
@@ -177,7 +250,7 @@ void MainWindow::RenderDeleteConfirmation() {
         ImGui::Text("Delete Session %d?", m_deleteSessionIndex + 1);
         ImGui::Spacing();
         ImGui::Text("Time: %s - %s (%s)", start_time.c_str(), end_time.c_str(), FormatDuration(duration).c_str());
-        ImGui::Text("Applications: %d", (int)session.applications.size());
+        ImGui::Text("Applications: %d", (int)session.application_count);
         ImGui::Spacing();
         ImGui::TextColored(ImVec4(1.0f, 0.5f, 0.5f, 1.0f), "This action cannot be undone!");
         ImGui::Spacing();
@@ -186,15 +259,8 @@ void MainWindow::RenderDeleteConfirmation() {
         
         if (ImGui::Button("Delete", ImVec2(120, 0)))
         {
-            // Perform deletion
-            if (m_sessionLoader.DeleteSession(m_sessions, m_deleteSessionIndex))
-            {
-                // Save updated sessions to file
-                if (m_sessionLoader.SaveToFile(m_dataFilePath, m_sessions))
-                {
-                    // Successfully deleted and saved
-                }
-            }
+            // Deleted on the loader thread (rewrites only the file holding the session)
+            m_loader.RequestDelete(session.start_timestamp);
             m_showDeleteConfirmation = false;
             ImGui::CloseCurrentPopup();
         }
@@ -274,39 +340,104 @@ void MainWindow::SetupFileWatcher() {
     
     std::string directoryPath = m_dataFilePath.substr(0, lastSlash);
     
-    // Set up directory change notification
-    m_fileWatcherHandle = FindFirstChangeNotificationA(
+    // Watch the directory with ReadDirectoryChangesW, which names the files
+    // that changed, so the viewer's own .bbcs writes can be told apart
+    m_watchedDirectory = CreateFileA(
         directoryPath.c_str(),
-        FALSE,  // Don't watch subtree
-        FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE
+        FILE_LIST_DIRECTORY,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr,
+        OPEN_EXISTING,
+        FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED,
+        nullptr
     );
+    HANDLE event = CreateEventA(nullptr, TRUE, FALSE, nullptr);
+    m_fileWatcherHandle = event ? event : INVALID_HANDLE_VALUE;
     
-    if (m_fileWatcherHandle == INVALID_HANDLE_VALUE) {
+    if (m_watchedDirectory == INVALID_HANDLE_VALUE || m_fileWatcherHandle == INVALID_HANDLE_VALUE || !WatchForChanges()) {
         // Failed to create watcher, disable it
+        CleanupFileWatcher();
         m_fileWatcherEnabled = false;
     }
 }
 
-void MainWindow::CheckFileWatcher() {
+bool MainWindow::WatchForChanges() {
+    // The subtree covers the history segments; segments are replaced by
+    // rename, hence FILE_NAME. The event stays signaled until this is
+    // called again.
+    ResetEvent(m_fileWatcherHandle);
+    m_watchOverlapped = OVERLAPPED();
+    m_watchOverlapped.hEvent = m_fileWatcherHandle;
+    return ReadDirectoryChangesW(
+        m_watchedDirectory,
+        m_watchBuffer,
+        sizeof(m_watchBuffer),
+        TRUE,
+        FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE | FILE_NOTIFY_CHANGE_FILE_NAME,
+        nullptr,
+        &m_watchOverlapped,
+        nullptr
+    ) != FALSE;
+}
+
+bool MainWindow::CheckFileWatcher() {
     if (m_fileWatcherHandle == INVALID_HANDLE_VALUE) {
-        return;
+        return false;
     }
     
     // Check if notification was signaled (non-blocking)
-    DWORD result = WaitForSingleObject(m_fileWatcherHandle, 0);
+    DWORD bytes = 0;
+    if (!GetOverlappedResult(m_watchedDirectory, &m_watchOverlapped, &bytes, FALSE)) {
+        if (GetLastError() == ERROR_IO_INCOMPLETE) {
+            return false;
+        }
+        bytes = 0;
+    }
     
-    if (result == WAIT_OBJECT_0) {
-        // Directory changed, mark for reload
-        m_shouldReload = true;
-        
-        // Reset the notification for next change
-        FindNextChangeNotification(m_fileWatcherHandle);
+    // An overflowed buffer (no records) may have lost any change
+    bool changed = bytes == 0;
+    for (DWORD offset = 0; offset < bytes && !changed; ) {
+        const FILE_NOTIFY_INFORMATION* info = (const FILE_NOTIFY_INFORMATION*)((const char*)m_watchBuffer + offset);
+        changed = IsHistoryFile(info->FileName, info->FileNameLength / sizeof(WCHAR));
+        if (info->NextEntryOffset == 0) {
+            break;
+        }
+        offset += info->NextEntryOffset;
+    }
+    
+    // Reset the notification for next change
+    if (!WatchForChanges()) {
+        CleanupFileWatcher();
+        m_fileWatcherEnabled = false;
     }
+    return changed;
+}
+
+bool MainWindow::IsHistoryFile(const WCHAR* name, size_t length) {
+    // Segments, the manifest, the legacy log and the journal. Stores
+    // (.bbcs) are the viewer's own cache, and temp files show up again
+    // under their final name when they are renamed.
+    static const WCHAR* const EXTENSIONS[] = { L".json", L".journal" };
+    for (const WCHAR* ext : EXTENSIONS) {
+        size_t extLength = wcslen(ext);
+        if (length >= extLength && _wcsnicmp(name + length - extLength, ext, extLength) == 0) {
+            return true;
+        }
+    }
+    return false;
 }
 
 void MainWindow::CleanupFileWatcher() {
+    if (m_watchedDirectory != INVALID_HANDLE_VALUE) {
+        // Cancel the pending read before its buffer and event go away
+        CancelIoEx(m_watchedDirectory, &m_watchOverlapped);
+        DWORD bytes = 0;
+        GetOverlappedResult(m_watchedDirectory, &m_watchOverlapped, &bytes, TRUE);
+        CloseHandle(m_watchedDirectory);
+        m_watchedDirectory = INVALID_HANDLE_VALUE;
+    }
     if (m_fileWatcherHandle != INVALID_HANDLE_VALUE) {
-        FindCloseChangeNotification(m_fileWatcherHandle);
+        CloseHandle(m_fileWatcherHandle);
         m_fileWatcherHandle = INVALID_HANDLE_VALUE;
     }
 }
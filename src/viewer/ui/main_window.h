@@ -1,13 +1,14 @@
 #pragma once
 
 #include <windows.h>
+#include <memory>
 #include <vector>
 #include <chrono>
 #include "session_data.h"
 #include "session_logger.h"
 #include "ui/settings_window.h"
 #include "ui/timeline_view.h"
-#include "data/session_loader.h"
+#include "data/background_loader.h"
 #include "data/filter_manager.h"
 #include "graphics/icon_manager.h"
 
@@ -21,6 +22,15 @@ namespace viewer {
  */
 class MainWindow {
 public:
+    /** @brief Most handles GetWaitHandles returns */
+    static constexpr size_t MAX_WAIT_HANDLES = 2;
+
+    /** @brief Frame interval while a load is in progress (progress bar) */
+    static constexpr DWORD LOADING_FRAME_MS = 33;
+
+    /** @brief Frame interval while a text field has focus (cursor blink) */
+    static constexpr DWORD TEXT_INPUT_FRAME_MS = 100;
+
     MainWindow(ID3D11Device* device);
     ~MainWindow();
 
@@ -30,7 +40,33 @@ public:
     void Render();
 
     /**
-     * @brief Reload session data from file
+     * @brief Handles that are signaled when the window has new data to show
+     * 
+     * The loader's update event and, while auto-refresh is on, the file
+     * watcher. The watcher stays signaled until OnWaitHandleSignaled or the
+     * next Render reads it.
+     * @return Number of handles written to `handles`
+     */
+    size_t GetWaitHandles(HANDLE* handles, size_t capacity) const;
+
+    /**
+     * @brief Handle one of the GetWaitHandles handles after it was signaled
+     * @return true if a frame is needed; false for file changes, which are
+     *         passed on to the loader
+     */
+    bool OnWaitHandleSignaled(HANDLE handle);
+
+    /**
+     * @brief Milliseconds until the next frame is needed without any event
+     * @return INFINITE when nothing on screen is animating, 0 while icons wait for upload
+     */
+    DWORD GetFrameTimeout() const;
+
+    /**
+     * @brief Queue a reload of whatever changed on disk
+     * 
+     * Loading runs on BackgroundLoader's thread; the result shows up at the
+     * start of a later frame.
      */
     void ReloadSessions();
 
@@ -43,17 +79,18 @@ public:
 private:
     // Components
     SessionLogger m_sessionLogger;
-    SessionLoader m_sessionLoader;
+    BackgroundLoader m_loader;
     FilterManager m_filterManager;
     IconManager m_iconManager;
     SettingsWindow m_settingsWindow;
     TimelineView m_timelineView;
 
-    // Data
-    std::vector<Session> m_sessions;
+    // Data (snapshot taken at the start of each frame)
+    std::shared_ptr<const SessionSnapshot> m_snapshot;
     std::string m_dataFilePath;
 
-    // Deletion state
+    // Deletion state; the snapshot keeps the session alive while the dialog is open
+    std::shared_ptr<const SessionSnapshot> m_deleteSnapshot;
     int m_deleteSessionIndex = -1;
     bool m_showDeleteConfirmation = false;
 
@@ -61,17 +98,27 @@ private:
     bool m_showStartSessionDialog = false;
     char m_sessionComment[256] = "";
     
-    // File watcher state
+    // Signaled by the loader's worker when there is something new to show
+    HANDLE m_updateEvent = NULL;
+    
+    // File watcher state: an overlapped ReadDirectoryChangesW on the data
+    // directory, completing into m_fileWatcherHandle (a manual-reset event)
     HANDLE m_fileWatcherHandle = INVALID_HANDLE_VALUE;
+    HANDLE m_watchedDirectory = INVALID_HANDLE_VALUE;
+    OVERLAPPED m_watchOverlapped = {};
+    DWORD m_watchBuffer[4096];          // FILE_NOTIFY_INFORMATION records (DWORD-aligned)
     bool m_fileWatcherEnabled = true;
-    bool m_shouldReload = false;
     
     void SetupFileWatcher();
-    void CheckFileWatcher();
+    bool WatchForChanges();
+    // True if a history file changed since the last call; re-arms the watcher
+    bool CheckFileWatcher();
     void CleanupFileWatcher();
+    static bool IsHistoryFile(const WCHAR* name, size_t length);
 
     // UI
     void RenderMenuBar();
+    void RenderLoadProgress();
     void RenderDeleteConfirmation();
     void RenderStartSessionDialog();
 };
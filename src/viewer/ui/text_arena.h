@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bigbrother {
+namespace viewer {
+
+/**
+ * @brief Append-only buffer of NUL-terminated display strings
+ *
+ * Strings are referenced by their offset, which stays valid until Clear even
+ * when the buffer grows. Once a string is in the arena, drawing it again
+ * costs no allocation.
+ */
+class TextArena {
+public:
+    static constexpr uint32_t NONE = 0xFFFFFFFFu;
+
+    /**
+     * @brief Copy `text` into the arena
+     * @return Offset to pass to Get
+     */
+    uint32_t Append(const std::string& text) {
+        uint32_t offset = (uint32_t)m_buffer.size();
+        m_buffer.insert(m_buffer.end(), text.begin(), text.end());
+        m_buffer.push_back('\0');
+        return offset;
+    }
+
+    /**
+     * @brief String at `offset`; only valid until the next Append or Clear
+     */
+    const char* Get(uint32_t offset) const {
+        return m_buffer.data() + offset;
+    }
+
+    void Clear() { m_buffer.clear(); }
+    size_t Size() const { return m_buffer.size(); }
+
+private:
+    std::vector<char> m_buffer;
+};
+
+} // namespace viewer
+} // namespace bigbrother
@@ -3,10 +3,30 @@
 #include "time_utils.h"
 #include <map>
 #include <algorithm>
+#include <ctime>
 
 namespace bigbrother {
 namespace viewer {
 
+namespace {
+
+// Local midnight at or before `timestamp`, and the following one
+void GetLocalDay(long long timestamp, long long& dayStart, long long& dayEnd) {
+    time_t rawtime = (time_t)timestamp;
+    struct tm timeinfo;
+    localtime_s(&timeinfo, &rawtime);
+    timeinfo.tm_hour = 0;
+    timeinfo.tm_min = 0;
+    timeinfo.tm_sec = 0;
+    timeinfo.tm_isdst = -1;
+    dayStart = (long long)mktime(&timeinfo);
+    timeinfo.tm_mday++;
+    timeinfo.tm_isdst = -1;
+    dayEnd = (long long)mktime(&timeinfo);
+}
+
+} // namespace
+
 TimelineView::TimelineView(IconManager& iconManager, FilterManager& filterManager)
     : m_iconManager(iconManager)
     , m_filterManager(filterManager)
@@ -16,54 +36,40 @@ TimelineView::TimelineView(IconManager& iconManager, FilterManager& filterManage
 TimelineView::~TimelineView() {
 }
 
-void TimelineView::Render(const std::vector<Session>& sessions) {
+void TimelineView::Render(const SessionSnapshot& sessions) {
     ImGui::Text("Session Timeline");
     ImGui::Separator();
     
+    // Rows are only rebuilt when something they depend on changed
+    if (sessions.GetGeneration() != m_rowsGeneration || sessions.size() != m_sessionEntries.size()) {
+        UpdateSessionEntries(sessions);
+        m_rowsGeneration = sessions.GetGeneration();
+        m_rowsDirty = true;
+    }
+    if (m_filterManager.GetVersion() != m_rowsFilterVersion) {
+        m_rowsFilterVersion = m_filterManager.GetVersion();
+        m_rowsDirty = true;
+    }
+    if (m_rowsDirty) {
+        RebuildRows(sessions);
+    }
+    
     if (ImGui::BeginChild("UnifiedTimeline", ImVec2(0, -30), true))
     {
-        std::string lastDate = "";
-        
-        // Safety limit: prevent crashes from rendering too many sessions
-        const size_t maxSessions = 1000;
-        size_t sessionsToRender = (sessions.size() > maxSessions) ? maxSessions : sessions.size();
-        
-        if (sessions.size() > maxSessions) {
-            ImGui::TextColored(ImVec4(1.0f, 0.5f, 0.0f, 1.0f), 
-                "Warning: Only showing first %zu of %zu sessions for performance", 
-                maxSessions, sessions.size());
-            ImGui::Separator();
+        if (sessions.empty())
+        {
+            ImGui::TextDisabled("No sessions recorded yet. Run the monitor to start tracking.");
         }
         
-        for (int sessionIdx = 0; sessionIdx < sessionsToRender; sessionIdx++)
+        // Toggling a node only marks the rows dirty; they are rebuilt next frame
+        ImGuiListClipper clipper;
+        clipper.Begin((int)m_rows.size(), ImGui::GetTextLineHeightWithSpacing());
+        while (clipper.Step())
         {
-            const auto& session = sessions[sessionIdx];
-            
-            // Check if we need to display a new date header
-            std::string currentDate = FormatDate(session.start_timestamp);
-            if (currentDate != lastDate)
+            for (int rowIdx = clipper.DisplayStart; rowIdx < clipper.DisplayEnd; rowIdx++)
             {
-                if (sessionIdx > 0) {
-                    ImGui::Spacing();
-                    ImGui::Spacing();
-                }
-                
-                // Display date header (non-expandable)
-                ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.8f, 0.8f, 1.0f, 1.0f)); // Light blue
-                ImGui::TextUnformatted(("--- " + FormatDateWithDay(session.start_timestamp) + " ---").c_str());
-                ImGui::PopStyleColor();
-                ImGui::Spacing();
-                
-                lastDate = currentDate;
+                RenderRow(m_rows[rowIdx], sessions);
             }
-            
-            RenderSession(session, sessionIdx);
-            ImGui::Spacing();
-        }
-        
-        if (sessions.empty())
-        {
-            ImGui::TextDisabled("No sessions recorded yet. Run the monitor to start tracking.");
         }
     }
     ImGui::EndChild();
@@ -71,68 +77,291 @@ void TimelineView::Render(const std::vector<Session>& sessions) {
     // Overall statistics bar at bottom
     ImGui::Separator();
     
-    // Count total applications and tabs
-    size_t totalApps = 0;
-    size_t totalTabs = 0;
-    for (const auto& session : sessions) {
-        totalApps += session.applications.size();
-        for (const auto& app : session.applications) {
-            totalTabs += app.tabs.size();
+    // Maintained by the loader as sessions are published
+    const SessionStats& stats = sessions.GetStats();
+    ImGui::Text("Total: %zu sessions | %zu applications | %zu tabs",
+                stats.GetSessionCount(), stats.GetApplicationCount(), stats.GetTabCount());
+}
+
+uint64_t TimelineView::GetSessionKey(const SessionHeader& session) {
+    return (uint64_t)session.start_timestamp;
+}
+
+uint64_t TimelineView::GetApplicationKey(uint64_t sessionKey, uint32_t nameId) {
+    // Start time in seconds fits the upper 40 bits, the interned name the lower 24
+    return (sessionKey << APPLICATION_NAME_BITS) | (nameId & ((1u << APPLICATION_NAME_BITS) - 1));
+}
+
+void TimelineView::PruneExpansionState(const SessionSnapshot& sessions) {
+    if (m_sessionStates.Size() == 0 && m_openApplications.Size() == 0) {
+        return;
+    }
+    
+    FlatHashMap<bool> live;
+    for (size_t i = 0; i < sessions.size(); i++) {
+        live[GetSessionKey(sessions[i])] = true;
+    }
+    
+    // Rebuild both tables without entries of removed sessions or reset to default
+    FlatHashMap<SessionState> sessionStates;
+    m_sessionStates.ForEach([&](uint64_t key, SessionState state) {
+        if (state != SessionState::Default && live.Find(key)) {
+            sessionStates[key] = state;
+        }
+    });
+    FlatHashMap<bool> openApplications;
+    m_openApplications.ForEach([&](uint64_t key, bool open) {
+        if (open && live.Find(key >> APPLICATION_NAME_BITS)) {
+            openApplications[key] = true;
         }
+    });
+    m_sessionStates = std::move(sessionStates);
+    m_openApplications = std::move(openApplications);
+    if (m_openApplications.Size() == 0) {
+        m_applicationNames.Clear();
     }
+}
+
+void TimelineView::UpdateSessionEntries(const SessionSnapshot& sessions) {
+    // Settled history is shared between snapshots, so its entries are still valid
+    size_t first = 0;
+    if (sessions.GetSettled() == m_entriesSettled) {
+        first = std::min(m_entriesSettled->size(), m_sessionEntries.size());
+    }
+    if (first == 0) {
+        // History was replaced (reload or deletion)
+        PruneExpansionState(sessions);
+    }
+    m_entriesSettled = sessions.GetSettled();
+    m_sessionEntries.resize(sessions.size());
     
-    ImGui::Text("Total: %zu sessions | %zu applications | %zu tabs", 
-                sessions.size(), totalApps, totalTabs);
+    long long dayStart = 0;
+    long long dayEnd = 0;
+    if (first > 0) {
+        GetLocalDay(sessions[first - 1].start_timestamp, dayStart, dayEnd);
+    }
+    for (size_t i = first; i < sessions.size(); i++) {
+        const SessionHeader& session = sessions[i];
+        SessionEntry& entry = m_sessionEntries[i];
+        
+        // A new date header whenever the local day changes
+        entry.startsDay = i == 0 || session.start_timestamp < dayStart || session.start_timestamp >= dayEnd;
+        if (entry.startsDay) {
+            GetLocalDay(session.start_timestamp, dayStart, dayEnd);
+        }
+        
+        // Sessions still being written start open, unless the user closed them.
+        // Sessions from sealed history start closed so their details are only
+        // decoded when the user expands them.
+        entry.open = session.IsDecoded();
+        if (m_sessionStates.Size() > 0) {
+            const SessionState* state = m_sessionStates.Find(GetSessionKey(session));
+            if (state && *state != SessionState::Default) {
+                entry.open = *state == SessionState::Open;
+            }
+        }
+    }
 }
 
-std::string TimelineView::GetSessionId(const Session& session, int sessionIndex) const {
-    return "session_" + std::to_string(session.start_timestamp) + "_" + std::to_string(sessionIndex);
+void TimelineView::RebuildRows(const SessionSnapshot& sessions) {
+    m_rows.clear();
+    m_rowDetails.clear();
+    m_rowText.Clear();
+    m_rowsDirty = false;
+    
+    for (uint32_t sessionIdx = 0; sessionIdx < (uint32_t)sessions.size(); sessionIdx++)
+    {
+        const SessionEntry& entry = m_sessionEntries[sessionIdx];
+        if (entry.startsDay)
+        {
+            if (sessionIdx > 0) {
+                AddRow(Row::Kind::Spacer, false, sessionIdx, 0, 0, 0);
+            }
+            AddRow(Row::Kind::DateHeader, false, sessionIdx, 0, 0, 0);
+        }
+        AddRow(Row::Kind::Session, entry.open, sessionIdx, 0, 0, 0);
+        if (!entry.open) {
+            continue;
+        }
+        
+        // Decoded on first expand, then served from the LRU
+        std::shared_ptr<const Session> details = m_detailCache.Get(sessions[sessionIdx]);
+        uint64_t sessionKey = GetSessionKey(sessions[sessionIdx]);
+        uint32_t detailsIdx = (uint32_t)m_rowDetails.size();
+        m_rowDetails.push_back(details);
+        
+        for (uint32_t appIdx = 0; appIdx < (uint32_t)details->applications.size(); appIdx++)
+        {
+            const auto& app = details->applications[appIdx];
+            
+            // Apply program filters
+            if (m_filterManager.IsFiltered(app.process_name)) {
+                continue;
+            }
+            
+            // Applications default to closed, only open if explicitly opened by user
+            bool appOpen = false;
+            if (m_openApplications.Size() > 0) {
+                uint32_t nameId = m_applicationNames.Find(app.process_name);
+                const bool* open = nameId == StringInterner::INVALID_ID ? nullptr
+                                 : m_openApplications.Find(GetApplicationKey(sessionKey, nameId));
+                appOpen = open && *open;
+            }
+            AddRow(Row::Kind::Application, appOpen, sessionIdx, detailsIdx, appIdx, 0);
+            if (!appOpen) {
+                continue;
+            }
+            
+            AddRow(Row::Kind::Path, false, sessionIdx, detailsIdx, appIdx, 0);
+            if (app.tabs.empty()) {
+                AddRow(Row::Kind::NoTabs, false, sessionIdx, detailsIdx, appIdx, 0);
+                continue;
+            }
+            AddRow(Row::Kind::TabsTitle, false, sessionIdx, detailsIdx, appIdx, 0);
+            
+            // Tabs are already sorted by time spent (longest first), see SortTabsByTime
+            for (uint32_t tabIdx = 0; tabIdx < (uint32_t)app.tabs.size(); tabIdx++) {
+                AddRow(Row::Kind::Tab, false, sessionIdx, detailsIdx, appIdx, tabIdx);
+            }
+        }
+    }
 }
 
-std::string TimelineView::GetApplicationId(const Session& session, const ApplicationFocusEvent& app, int appIndex) const {
-    return "app_" + std::to_string(session.start_timestamp) + "_" + app.process_name + "_" + std::to_string(appIndex);
+void TimelineView::AddRow(Row::Kind kind, bool open, uint32_t session, uint32_t details, uint32_t application,
+                          uint32_t tab) {
+    m_rows.push_back({ kind, open, session, details, application, tab, TextArena::NONE });
 }
 
-void TimelineView::RenderSession(const Session& session, int sessionIndex) {
-    ImGui::PushID(sessionIndex);
+const char* TimelineView::GetRowText(Row& row, const SessionSnapshot& sessions) {
+    // Formatted the first time the row is visible, then drawn from the arena
+    if (row.text == TextArena::NONE) {
+        row.text = m_rowText.Append(FormatRowText(row, sessions));
+    }
+    return m_rowText.Get(row.text);
+}
+
+std::string TimelineView::FormatRowText(const Row& row, const SessionSnapshot& sessions) const {
+    switch (row.kind) {
+    case Row::Kind::DateHeader:
+        return "--- " + FormatDateWithDay(sessions[row.session].start_timestamp) + " ---";
     
-    // Generate stable ID for this session
-    std::string sessionId = GetSessionId(session, sessionIndex);
+    case Row::Kind::Session: {
+        const SessionHeader& session = sessions[row.session];
+        
+        // Calculate session duration
+        long long session_duration = session.end_timestamp - session.start_timestamp;
+        
+        // Session header with timestamps and duration
+        std::string session_header = "Session " + std::to_string(row.session + 1) +
+                            "  (" + FormatTime(session.start_timestamp) + " - " +
+                            FormatTime(session.end_timestamp) + ", " +
+                            FormatDuration(session_duration) + ")";
+        
+        // Add comment if present
+        if (!session.comment.empty()) {
+            session_header += " - " + session.comment;
+        }
+        return session_header;
+    }
     
-    // Calculate session duration
-    long long session_duration = session.end_timestamp - session.start_timestamp;
+    case Row::Kind::Application: {
+        const ApplicationFocusEvent& app = m_rowDetails[row.details]->applications[row.application];
+        
+        // Application header with total time
+        return app.process_name + " - " + FormatDurationMs(app.total_time_spent_ms) +
+               " (" + FormatTime(app.first_focus_time) + " to " + FormatTime(app.last_focus_time) + ")";
+    }
     
-    // Session header with timestamps and duration
-    std::string start_time = FormatTime(session.start_timestamp);
-    std::string end_time = FormatTime(session.end_timestamp);
-    std::string session_header = "Session " + std::to_string(sessionIndex + 1) + 
-                        "  (" + start_time + " - " + end_time + ", " + 
-                        FormatDuration(session_duration) + ")";
+    case Row::Kind::Tab: {
+        const TabInfo& tab = m_rowDetails[row.details]->applications[row.application].tabs[row.tab];
+        
+        // Pad duration to 8 characters for alignment
+        std::string duration = FormatDurationMs(tab.total_time_spent_ms);
+        if (duration.length() < 8) {
+            duration.insert(0, 8 - duration.length(), ' ');
+        }
+        return duration + " | " + tab.window_title;
+    }
     
-    // Add comment if present
-    if (!session.comment.empty()) {
-        session_header += " - " + session.comment;
+    default:
+        return std::string();
+    }
+}
+
+void TimelineView::SetSessionOpen(const SessionSnapshot& sessions, uint32_t sessionIndex, bool open) {
+    m_sessionStates[GetSessionKey(sessions[sessionIndex])] = open ? SessionState::Open : SessionState::Closed;
+    m_sessionEntries[sessionIndex].open = open;
+    m_rowsDirty = true;
+}
+
+void TimelineView::SetApplicationOpen(const SessionSnapshot& sessions, const Row& row, bool open) {
+    const ApplicationFocusEvent& app = m_rowDetails[row.details]->applications[row.application];
+    uint32_t nameId = m_applicationNames.Intern(app.process_name);
+    m_openApplications[GetApplicationKey(GetSessionKey(sessions[row.session]), nameId)] = open;
+    m_rowsDirty = true;
+}
+
+void TimelineView::RenderRow(Row& row, const SessionSnapshot& sessions) {
+    // Rows below a session are indented like nested tree nodes
+    int depth = 0;
+    switch (row.kind) {
+    case Row::Kind::Application: depth = 1; break;
+    case Row::Kind::Path:
+    case Row::Kind::TabsTitle:
+    case Row::Kind::NoTabs: depth = 2; break;
+    case Row::Kind::Tab: depth = 3; break;
+    default: break;
+    }
+    if (depth > 0) {
+        ImGui::SetCursorPosX(ImGui::GetCursorPosX() + depth * ImGui::GetStyle().IndentSpacing);
     }
     
-    // Determine if this session should be open
-    // New sessions default to open, existing sessions use tracked state
-    bool isNew = m_seenSessions.count(sessionId) == 0;
-    bool isClosed = m_closedSessions.count(sessionId) > 0;
-    ImGuiTreeNodeFlags flags = (isNew || !isClosed) ? ImGuiTreeNodeFlags_DefaultOpen : ImGuiTreeNodeFlags_None;
+    switch (row.kind) {
+    case Row::Kind::Spacer:
+        ImGui::Dummy(ImVec2(0.0f, ImGui::GetTextLineHeight()));
+        break;
+    case Row::Kind::DateHeader:
+        // Display date header (non-expandable)
+        ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.8f, 0.8f, 1.0f, 1.0f)); // Light blue
+        ImGui::TextUnformatted(GetRowText(row, sessions));
+        ImGui::PopStyleColor();
+        break;
+    case Row::Kind::Session:
+        RenderSessionRow(row, sessions);
+        break;
+    case Row::Kind::Application:
+        RenderApplicationRow(row, sessions);
+        break;
+    case Row::Kind::Path:
+        ImGui::Text("Path: %s", m_rowDetails[row.details]->applications[row.application].process_path.c_str());
+        break;
+    case Row::Kind::TabsTitle:
+        ImGui::Text("Time per Tab:");
+        break;
+    case Row::Kind::NoTabs:
+        ImGui::Text("No tabs recorded");
+        break;
+    case Row::Kind::Tab:
+        ImGui::TextUnformatted(GetRowText(row, sessions));
+        break;
+    }
+}
+
+void TimelineView::RenderSessionRow(Row& row, const SessionSnapshot& sessions) {
+    int sessionIndex = (int)row.session;
+    ImGui::PushID(sessionIndex);
     
-    // Mark as seen
-    m_seenSessions.insert(sessionId);
+    // Open state is ours, not ImGui's, so clipped rows keep it too
+    ImGui::SetNextItemOpen(row.open);
     
     // Session tree node with distinct color
     ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(0.6f, 1.0f, 0.6f, 1.0f)); // Light green
-    bool session_open = ImGui::TreeNodeEx(session_header.c_str(), flags);
+    bool session_open = ImGui::TreeNodeEx(GetRowText(row, sessions), ImGuiTreeNodeFlags_NoTreePushOnOpen);
     ImGui::PopStyleColor();
     
     // Track state change
-    if (!session_open) {
-        m_closedSessions.insert(sessionId);
-    } else {
-        m_closedSessions.erase(sessionId);
+    if (session_open != row.open) {
+        SetSessionOpen(sessions, row.session, session_open);
     }
     
     // Right-click context menu for session
@@ -147,79 +376,37 @@ void TimelineView::RenderSession(const Session& session, int sessionIndex) {
         ImGui::EndPopup();
     }
     
-    if (session_open)
-    {
-        // Display applications for this session
-        const size_t maxAppsPerSession = 500;
-        size_t appsRendered = 0;
-        
-        for (int appIdx = 0; appIdx < session.applications.size(); appIdx++)
-        {
-            const auto& app = session.applications[appIdx];
-            
-            // Apply program filters
-            if (m_filterManager.IsFiltered(app.process_name)) {
-                continue; // Skip this app
-            }
-            
-            // Safety limit per session
-            if (appsRendered >= maxAppsPerSession) {
-                ImGui::TextColored(ImVec4(1.0f, 0.5f, 0.0f, 1.0f), 
-                    "... %zu more applications (hidden for performance)", 
-                    session.applications.size() - appIdx);
-                break;
-            }
-            
-            RenderApplication(session, app, appIdx);
-            appsRendered++;
-        }
-        
-        ImGui::TreePop();
-    }
-    
     ImGui::PopID();
 }
 
-void TimelineView::RenderApplication(const Session& session, const ApplicationFocusEvent& app, int appIndex) {
-    ImGui::PushID(appIndex);
-    
-    // Generate stable ID for this application
-    std::string appId = GetApplicationId(session, app, appIndex);
-    
-    // Application header with icon and total time
-    std::string first_focus_time = FormatTime(app.first_focus_time);
-    std::string last_focus_time = FormatTime(app.last_focus_time);
-    std::string total_time = FormatDurationMs(app.total_time_spent_ms);
+void TimelineView::RenderApplicationRow(Row& row, const SessionSnapshot& sessions) {
+    const ApplicationFocusEvent& app = m_rowDetails[row.details]->applications[row.application];
+    ImGui::PushID((int)row.session);
+    ImGui::PushID((int)row.application);
     
-    std::string app_header = app.process_name + " - " + total_time + 
-                           " (" + first_focus_time + " to " + last_focus_time + ")";
-    
-    // Get and display application icon
-    ID3D11ShaderResourceView* icon = m_iconManager.GetIcon(app.process_path);
-    if (icon) {
-        ImGui::Image((void*)icon, ImVec2(16, 16));
+    // Get and display application icon, sized to the text so rows keep one height
+    IconManager::Icon icon = m_iconManager.GetIcon(app.process_path);
+    if (icon.texture) {
+        float iconSize = ImGui::GetTextLineHeight();
+        ImGui::Image((void*)icon.texture, ImVec2(iconSize, iconSize), ImVec2(icon.u0, icon.v0), ImVec2(icon.u1, icon.v1));
+        ImGui::SameLine();
+    } else if (icon.pending) {
+        // Keep the icon's space so the row doesn't shift when it arrives
+        float iconSize = ImGui::GetTextLineHeight();
+        ImGui::Dummy(ImVec2(iconSize, iconSize));
         ImGui::SameLine();
     }
     
-    // Determine if this application should be open
-    // Applications default to closed, only open if explicitly opened by user
-    bool isNew = m_seenApplications.count(appId) == 0;
-    bool wasOpened = m_openApplications.count(appId) > 0;
-    ImGuiTreeNodeFlags flags = (!isNew && wasOpened) ? ImGuiTreeNodeFlags_DefaultOpen : ImGuiTreeNodeFlags_None;
-    
-    // Mark as seen
-    m_seenApplications.insert(appId);
+    ImGui::SetNextItemOpen(row.open);
     
     // Application tree node with yellow color
     ImGui::PushStyleColor(ImGuiCol_Text, ImVec4(1.0f, 1.0f, 0.6f, 1.0f)); // Light yellow
-    bool app_open = ImGui::TreeNodeEx(app_header.c_str(), flags);
+    bool app_open = ImGui::TreeNodeEx(GetRowText(row, sessions), ImGuiTreeNodeFlags_NoTreePushOnOpen);
     ImGui::PopStyleColor();
     
     // Track state change
-    if (app_open) {
-        m_openApplications.insert(appId);
-    } else {
-        m_openApplications.erase(appId);
+    if (app_open != row.open) {
+        SetApplicationOpen(sessions, row, app_open);
     }
     
     // Right-click context menu
@@ -236,49 +423,8 @@ void TimelineView::RenderApplication(const Session& session, const ApplicationFo
         ImGui::EndPopup();
     }
     
-    if (app_open)
-    {
-        ImGui::Text("Path: %s", app.process_path.c_str());
-        
-        RenderTabs(app.tabs);
-        
-        ImGui::TreePop();
-    }
-    
     ImGui::PopID();
-}
-
-void TimelineView::RenderTabs(const std::vector<TabInfo>& tabs) {
-    if (tabs.empty()) {
-        ImGui::Text("No tabs recorded");
-        return;
-    }
-    
-    ImGui::Spacing();
-    
-    // Sort tabs by time spent (longest first)
-    std::vector<TabInfo> sortedTabs = tabs;
-    std::sort(sortedTabs.begin(), sortedTabs.end(), 
-        [](const TabInfo& a, const TabInfo& b) { 
-            return a.total_time_spent_ms > b.total_time_spent_ms; 
-        });
-    
-    ImGui::Text("Time per Tab:");
-    ImGui::Indent();
-    
-    for (const auto& tab : sortedTabs)
-    {
-        // Format duration with fixed width for alignment
-        std::string duration = FormatDurationMs(tab.total_time_spent_ms);
-        // Pad duration to 8 characters for alignment
-        while (duration.length() < 8) {
-            duration = " " + duration;
-        }
-        
-        std::string display = duration + " | " + tab.window_title;
-        ImGui::Text("%s", display.c_str());
-    }
-    ImGui::Unindent();
+    ImGui::PopID();
 }
 
 std::string TimelineView::FormatDurationMs(long long durationMs) const {
@@ -1,21 +1,32 @@
 #pragma once
 
+#include <cstdint>
 #include <vector>
 #include <functional>
-#include <set>
+#include <memory>
 #include <string>
 #include "session_data.h"
+#include "flat_hash_map.h"
+#include "string_interner.h"
 #include "graphics/icon_manager.h"
 #include "data/filter_manager.h"
+#include "data/session_snapshot.h"
+#include "data/session_index.h"
+#include "ui/text_arena.h"
 
 namespace bigbrother {
 namespace viewer {
 
 /**
  * @brief Timeline view UI component
- * 
+ *
  * Renders the session timeline with applications and tabs,
  * grouped by date, with icons and filtering.
+ *
+ * The tree is flattened into a list of fixed-height rows, rebuilt only when
+ * the snapshot, the filters or the expansion state change. Each frame only
+ * the rows visible through ImGuiListClipper are submitted, so frame time
+ * does not grow with the length of the history.
  */
 class TimelineView {
 public:
@@ -24,9 +35,9 @@ public:
 
     /**
      * @brief Render the timeline view
-     * @param sessions List of sessions to display
+     * @param sessions Snapshot of the sessions to display
      */
-    void Render(const std::vector<Session>& sessions);
+    void Render(const SessionSnapshot& sessions);
 
     /**
      * @brief Set callback for session deletion requests
@@ -37,29 +48,97 @@ public:
     }
 
 private:
+    /**
+     * @brief One line of the flattened tree
+     */
+    struct Row {
+        enum class Kind : unsigned char {
+            Spacer,
+            DateHeader,
+            Session,
+            Application,
+            Path,
+            TabsTitle,
+            NoTabs,
+            Tab
+        };
+
+        Kind kind;
+        bool open;              // Session and Application rows
+        uint32_t session;       // Index in the snapshot
+        uint32_t details;       // Index in m_rowDetails (Application rows and below)
+        uint32_t application;
+        uint32_t tab;
+        uint32_t text;          // Label in m_rowText, formatted when first drawn
+    };
+
+    /**
+     * @brief Expansion the user chose for a session
+     */
+    enum class SessionState : unsigned char {
+        Default,                // Open while being written, closed once sealed
+        Open,
+        Closed
+    };
+
+    /**
+     * @brief What the rows need to know about each session of the snapshot
+     */
+    struct SessionEntry {
+        bool startsDay;         // First session of its local calendar day
+        bool open;
+    };
+
+    static constexpr unsigned APPLICATION_NAME_BITS = 24;
+
     IconManager& m_iconManager;
     FilterManager& m_filterManager;
     std::function<void(int)> m_deleteSessionCallback;
-    
-    // State tracking for tree node expansion
-    std::set<std::string> m_closedSessions;      // Session IDs that are explicitly closed by user
-    std::set<std::string> m_openApplications;    // Application IDs that are explicitly opened by user
-    std::set<std::string> m_seenSessions;        // Sessions we've seen (to distinguish new from existing)
-    std::set<std::string> m_seenApplications;    // Applications we've seen
-    
-    // Generate stable IDs for state tracking
-    std::string GetSessionId(const Session& session, int sessionIndex) const;
-    std::string GetApplicationId(const Session& session, const ApplicationFocusEvent& app, int appIndex) const;
 
-    // Render a single session
-    void RenderSession(const Session& session, int sessionIndex);
-    
-    // Render an application within a session
-    void RenderApplication(const Session& session, const ApplicationFocusEvent& app, int appIndex);
+    // State tracking for tree node expansion, keyed by GetSessionKey / GetApplicationKey
+    FlatHashMap<SessionState> m_sessionStates;   // Sessions the user opened or closed
+    FlatHashMap<bool> m_openApplications;        // Applications the user opened (default closed)
+    StringInterner m_applicationNames;           // Process names used in application keys
+
+    // Details of expanded history sessions
+    SessionDetailCache m_detailCache;
+
+    // Flattened tree and the inputs it was built from
+    std::vector<SessionEntry> m_sessionEntries;
+    std::shared_ptr<const std::vector<SessionHeader>> m_entriesSettled;  // Settled part the entries were computed for
+    std::vector<Row> m_rows;
+    std::vector<std::shared_ptr<const Session>> m_rowDetails;  // Expanded sessions the rows point into
+    TextArena m_rowText;                                       // Row labels; cleared with the rows
+    uint64_t m_rowsGeneration = 0;
+    uint64_t m_rowsFilterVersion = 0;
+    bool m_rowsDirty = true;
+
+    // Stable keys for state tracking; they survive deletions and reloads
+    static uint64_t GetSessionKey(const SessionHeader& session);
+    static uint64_t GetApplicationKey(uint64_t sessionKey, uint32_t nameId);
     
-    // Render tabs for an application
-    void RenderTabs(const std::vector<TabInfo>& tabs);
+    // Drop expansion state of sessions that are no longer in the snapshot
+    void PruneExpansionState(const SessionSnapshot& sessions);
+
+    // Recompute day breaks and open state of the sessions that changed
+    void UpdateSessionEntries(const SessionSnapshot& sessions);
+
+    // Flatten the expanded parts of the tree into m_rows
+    void RebuildRows(const SessionSnapshot& sessions);
+    void AddRow(Row::Kind kind, bool open, uint32_t session, uint32_t details, uint32_t application, uint32_t tab);
     
+    // Label of a row, formatted into the arena on first use
+    const char* GetRowText(Row& row, const SessionSnapshot& sessions);
+    std::string FormatRowText(const Row& row, const SessionSnapshot& sessions) const;
+
+    void SetSessionOpen(const SessionSnapshot& sessions, uint32_t sessionIndex, bool open);
+    void SetApplicationOpen(const SessionSnapshot& sessions, const Row& row, bool open);
+
+    // Render one row; all rows are one text line high
+    void RenderRow(Row& row, const SessionSnapshot& sessions);
+    void RenderSessionRow(Row& row, const SessionSnapshot& sessions);
+    void RenderApplicationRow(Row& row, const SessionSnapshot& sessions);
+
     // Format time duration from milliseconds
     std::string FormatDurationMs(long long durationMs) const;
 };
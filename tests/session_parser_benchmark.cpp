@@ -0,0 +1,148 @@
+// Times the viewer's session parsers on generated focus_log.json documents.
+//
+//   session_parser_benchmark [max MB]
+//
+// Sizes double from 1 MB up to max MB (default 64; pass 1024 for 1 GB, which
+// needs several GB of memory). For each size it reports stage 1 (the
+// StructuralScanner alone, at every level) and the full parse: nlohmann's
+// SAX parser, the structural decoder, and the decoder on a worker pool.
+// Build in Release for meaningful numbers.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <functional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "data/session_parser.h"
+#include "data/structural_scanner.h"
+
+using namespace bigbrother;
+using namespace bigbrother::viewer;
+
+namespace {
+
+const char* const PROGRAMS[] = { "chrome.exe", "Code.exe", "explorer.exe", "Slack.exe", "WINWORD.EXE",
+                                 "devenv.exe", "Spotify.exe", "Teams.exe", "firefox.exe", "cmd.exe" };
+
+const char* const TITLE_WORDS[] = { "Inbox", "Pull request", "\\u00e9dition", "build.log", "Caf\xc3\xa9",
+                                    "\\\"quoted\\\"", "C:\\\\Users\\\\me", "\xe2\x80\x94", "Untitled", "Meeting" };
+
+// One session in the monitor's output format: ~20 programs with a few tabs each
+void AppendSession(std::mt19937_64& rng, long long start, std::string& out) {
+    char buffer[256];
+    out += "{\"start_timestamp\":" + std::to_string(start) + ",\"end_timestamp\":" + std::to_string(start + 3600) +
+           ",\"comment\":\"Generated session\",\"applications\":[";
+    for (int a = 0, apps = 10 + (int)(rng() % 20); a < apps; a++) {
+        const char* program = PROGRAMS[rng() % 10];
+        snprintf(buffer, sizeof(buffer),
+                 "%s{\"process_name\":\"%s\",\"process_path\":\"C:\\\\Program Files\\\\App%d\\\\%s\","
+                 "\"first_focus_time\":%lld,\"last_focus_time\":%lld,\"total_time_spent_ms\":%llu,\"tabs\":[",
+                 a ? "," : "", program, a, program, start + a, start + 1800 + a,
+                 (unsigned long long)(rng() % 3600000));
+        out += buffer;
+        for (int t = 0, tabs = 1 + (int)(rng() % 6); t < tabs; t++) {
+            out += t ? ",{\"window_title\":\"" : "{\"window_title\":\"";
+            for (int w = 0, words = 2 + (int)(rng() % 6); w < words; w++) {
+                out += (w ? " " : "") + std::string(TITLE_WORDS[rng() % 10]);
+            }
+            out += "\",\"total_time_spent_ms\":" + std::to_string(rng() % 600000) + "}";
+        }
+        out += "]}";
+    }
+    out += "]}";
+}
+
+std::string GenerateDocument(size_t bytes) {
+    std::mt19937_64 rng(7);
+    std::string out = "{\"sessions\":[";
+    out.reserve(bytes + 64 * 1024);
+    for (long long start = 1700000000; out.size() < bytes; start += 7200) {
+        if (out.back() != '[') {
+            out += ',';
+        }
+        AppendSession(rng, start, out);
+    }
+    return out + "]}";
+}
+
+// Best of `runs` wall-clock times, in seconds
+double Time(int runs, const std::function<void()>& run) {
+    double best = 1e30;
+    for (int i = 0; i < runs; i++) {
+        auto start = std::chrono::steady_clock::now();
+        run();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+void Report(const char* name, size_t bytes, double seconds, double baseline) {
+    printf("  %-28s %9.1f ms %8.0f MB/s", name, seconds * 1000, bytes / seconds / (1 << 20));
+    if (baseline > 0) {
+        printf("  %5.2fx", baseline / seconds);
+    }
+    printf("\n");
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+    size_t maxMB = argc > 1 ? (size_t)std::strtoull(argv[1], nullptr, 10) : 64;
+    const struct { StructuralScanner::Level level; const char* name; } levels[] = {
+        { StructuralScanner::Level::Scalar, "stage 1, scalar" },
+        { StructuralScanner::Level::SSE2, "stage 1, SSE2" },
+        { StructuralScanner::Level::AVX2, "stage 1, AVX2" },
+    };
+    printf("best scanner level: %d\n", (int)StructuralScanner::GetBestLevel());
+
+    for (size_t mb = 1; mb <= std::max<size_t>(maxMB, 1); mb *= 2) {
+        std::string text = GenerateDocument(mb << 20);
+        const char* begin = text.data();
+        const char* end = begin + text.size();
+        int runs = mb <= 64 ? 3 : 1;
+        printf("%zu MB (%zu bytes)\n", mb, text.size());
+
+        for (const auto& entry : levels) {
+            double seconds = Time(runs, [&]() {
+                StructuralScanner scanner(begin, end, entry.level);
+                while (scanner.Next() != StructuralScanner::NONE) {
+                }
+            });
+            Report(entry.name, text.size(), seconds, 0);
+        }
+
+        // Every parser must agree before its time means anything
+        size_t expected = 0;
+        double sax = Time(runs, [&]() {
+            std::vector<Session> sessions;
+            std::istringstream stream(text);
+            if (!SessionParser::ParseDocument(stream, sessions)) {
+                printf("SAX parser rejected the document\n");
+                std::exit(1);
+            }
+            expected = sessions.size();
+        });
+        Report("nlohmann SAX", text.size(), sax, 0);
+
+        const struct { const char* name; unsigned threads; } parsers[] = {
+            { "structural decoder", 1 },
+            { "decoder, worker pool", 0 },
+        };
+        for (const auto& parser : parsers) {
+            double seconds = Time(runs, [&]() {
+                std::vector<Session> sessions;
+                if (!SessionParser::ParseDocumentParallel(begin, end, sessions, parser.threads) ||
+                    sessions.size() != expected) {
+                    printf("%s disagrees with the SAX parser\n", parser.name);
+                    std::exit(1);
+                }
+            });
+            Report(parser.name, text.size(), seconds, sax);
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,308 @@
+// Checks that every in-memory SessionParser path gives exactly what the
+// nlohmann SAX parser gives (ParseDocument on a stream), on random
+// documents of the focus_log.json schema and on mutated, malformed copies.
+
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "data/session_parser.h"
+
+using namespace bigbrother;
+using namespace bigbrother::viewer;
+
+namespace {
+
+std::mt19937_64 g_rng(42);
+
+int Random(int n) {
+    return (int)(g_rng() % (uint64_t)n);
+}
+
+std::string Space() {
+    static const char* SPACES[] = { "", " ", "\n  ", "\t", "\r\n", " \n    " };
+    return Random(3) ? "" : SPACES[Random(6)];
+}
+
+std::string RandomString() {
+    // Escapes, multi-byte UTF-8 and surrogate pairs
+    static const char* PARTS[] = {
+        "a", "Hello", "\\\"", "\\\\", "\\/", "\\n", "\\t", "\\u0041", "\\u00e9",
+        "\\ud83d\\ude00", "\xc3\xa9", "\xe2\x80\x94", "\xe6\x97\xa5", " ", "\\b", "x\\u0000y"
+    };
+    std::string s = "\"";
+    for (int i = Random(5); i > 0; i--) {
+        s += PARTS[Random(sizeof(PARTS) / sizeof(PARTS[0]))];
+    }
+    return s + "\"";
+}
+
+std::string RandomNumber() {
+    switch (Random(10)) {
+    case 0: return "-" + std::to_string(g_rng() % 1000000);
+    case 1: return "1.5";
+    case 2: return "12345678901234567890";
+    case 3: return "0";
+    case 4: return "1e3";
+    default: return std::to_string(g_rng() % 2000000000000ull);
+    }
+}
+
+// Any JSON value, for unknown keys and fields of the wrong type
+std::string RandomValue(int depth) {
+    switch (depth > 3 ? Random(4) : Random(7)) {
+    case 0: return RandomNumber();
+    case 1: return RandomString();
+    case 2: return "true";
+    case 3: return "null";
+    case 4: {
+        std::string s = "[" + Space();
+        for (int i = 0, n = Random(3); i < n; i++) {
+            s += (i ? "," + Space() : "") + RandomValue(depth + 1);
+        }
+        return s + Space() + "]";
+    }
+    default: {
+        std::string s = "{" + Space();
+        for (int i = 0, n = Random(3); i < n; i++) {
+            s += (i ? "," : "") + Space() + RandomString() + Space() + ":" + Space() + RandomValue(depth + 1);
+        }
+        return s + "}";
+    }
+    }
+}
+
+std::string Field(const char* key, const std::string& value) {
+    return Space() + "\"" + key + "\"" + Space() + ":" + Space() + value;
+}
+
+std::string NumberValue() {
+    return Random(20) ? std::to_string(g_rng() % 2000000000000ull) : RandomValue(2);
+}
+
+std::string StringValue() {
+    return Random(20) ? RandomString() : RandomValue(2);
+}
+
+std::string Object(std::vector<std::string> fields) {
+    if (Random(8) == 0) {
+        fields.push_back(Field("unknown", RandomValue(1)));
+    }
+    if (Random(10) == 0 && !fields.empty()) {
+        fields.push_back(fields[0]);  // Duplicate key: the last one wins
+    }
+    std::shuffle(fields.begin(), fields.end(), g_rng);
+    std::string s = "{";
+    for (size_t i = 0; i < fields.size(); i++) {
+        s += (i ? "," : "") + fields[i];
+    }
+    return s + Space() + "}";
+}
+
+std::string Array(const std::vector<std::string>& elements) {
+    std::string s = "[";
+    for (size_t i = 0; i < elements.size(); i++) {
+        s += (i ? "," : "") + Space() + elements[i];
+    }
+    return s + Space() + "]";
+}
+
+std::string RandomTab() {
+    return Object({ Field("window_title", StringValue()), Field("total_time_spent_ms", NumberValue()) });
+}
+
+std::string RandomApplication() {
+    std::vector<std::string> tabs;
+    for (int i = Random(4); i > 0; i--) {
+        tabs.push_back(Random(30) ? RandomTab() : RandomValue(1));
+    }
+    std::vector<std::string> fields = {
+        Field("process_name", StringValue()),
+        Field("process_path", StringValue()),
+        Field("first_focus_time", NumberValue()),
+        Field("last_focus_time", NumberValue()),
+        Field("total_time_spent_ms", NumberValue())
+    };
+    if (Random(10)) {
+        fields.push_back(Field("tabs", Random(30) ? Array(tabs) : RandomValue(1)));
+    }
+    return Object(fields);
+}
+
+std::string RandomSession() {
+    std::vector<std::string> applications;
+    for (int i = Random(5); i > 0; i--) {
+        applications.push_back(Random(30) ? RandomApplication() : RandomValue(1));
+    }
+    std::vector<std::string> fields = {
+        Field("start_timestamp", NumberValue()),
+        Field("end_timestamp", NumberValue()),
+        Field("comment", StringValue())
+    };
+    if (Random(10)) {
+        fields.push_back(Field("applications", Random(30) ? Array(applications) : RandomValue(1)));
+    }
+    return Object(fields);
+}
+
+std::string RandomDocument(int maxSessions) {
+    std::vector<std::string> sessions;
+    for (int i = Random(maxSessions); i > 0; i--) {
+        sessions.push_back(Random(30) ? RandomSession() : RandomValue(1));
+    }
+    std::vector<std::string> fields = { Field("sessions", Array(sessions)) };
+    if (Random(5) == 0) {
+        fields.push_back(Field("version", RandomNumber()));
+    }
+    return Space() + Object(fields) + Space();
+}
+
+std::string Mutate(std::string text) {
+    static const char BYTES[] = "{}[]:,\"\\ 0-.eE1a\x01\xc3\xa9\xff";
+    for (int i = Random(3) + 1; i > 0 && !text.empty(); i--) {
+        size_t at = g_rng() % text.size();
+        switch (Random(3)) {
+        case 0: text.erase(at, 1 + Random(3)); break;
+        case 1: text.insert(text.begin() + at, BYTES[Random(sizeof(BYTES) - 1)]); break;
+        default: text[at] = BYTES[Random(sizeof(BYTES) - 1)]; break;
+        }
+    }
+    return text;
+}
+
+bool Equal(const TabInfo& a, const TabInfo& b) {
+    return a.window_title == b.window_title && a.total_time_spent_ms == b.total_time_spent_ms;
+}
+
+bool Equal(const ApplicationFocusEvent& a, const ApplicationFocusEvent& b) {
+    return a.process_name == b.process_name && a.process_path == b.process_path &&
+           a.first_focus_time == b.first_focus_time && a.last_focus_time == b.last_focus_time &&
+           a.total_time_spent_ms == b.total_time_spent_ms &&
+           std::equal(a.tabs.begin(), a.tabs.end(), b.tabs.begin(), b.tabs.end(),
+                      [](const TabInfo& x, const TabInfo& y) { return Equal(x, y); });
+}
+
+bool Equal(const Session& a, const Session& b) {
+    return a.start_timestamp == b.start_timestamp && a.end_timestamp == b.end_timestamp && a.comment == b.comment &&
+           std::equal(a.applications.begin(), a.applications.end(), b.applications.begin(), b.applications.end(),
+                      [](const ApplicationFocusEvent& x, const ApplicationFocusEvent& y) { return Equal(x, y); });
+}
+
+bool Equal(const std::vector<Session>& a, const std::vector<Session>& b) {
+    return std::equal(a.begin(), a.end(), b.begin(), b.end(),
+                      [](const Session& x, const Session& y) { return Equal(x, y); });
+}
+
+int g_failures = 0;
+
+void Fail(const char* check, const std::string& text) {
+    if (g_failures++ < 5) {
+        printf("FAILED: %s\n%s\n\n", check, text.c_str());
+    }
+}
+
+// Everything parsed from memory must match the SAX parser, including the
+// prefix kept and the result reported for malformed input
+void CheckDocument(const std::string& text) {
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+
+    std::vector<Session> expected;
+    std::istringstream stream(text);
+    bool expectedOk = SessionParser::ParseDocument(stream, expected);
+
+    std::vector<Session> decoded;
+    if (SessionParser::ParseDocument(begin, end, decoded) != expectedOk || !Equal(decoded, expected)) {
+        Fail("ParseDocument", text);
+    }
+
+    std::vector<Session> parallel;
+    if (SessionParser::ParseDocumentParallel(begin, end, parallel, 3) != expectedOk || !Equal(parallel, expected)) {
+        Fail("ParseDocumentParallel", text);
+    }
+
+    // A successful pre-scan whose sessions all parse promises a well-formed document
+    std::vector<SessionParser::Range> ranges;
+    if (!SessionParser::FindSessions(begin, end, ranges)) {
+        return;
+    }
+    std::vector<Session> sessions(ranges.size());
+    for (size_t i = 0; i < ranges.size(); i++) {
+        if (!SessionParser::ParseSession(begin + ranges[i].begin, begin + ranges[i].end, sessions[i])) {
+            return;
+        }
+    }
+    if (!expectedOk || !Equal(sessions, expected)) {
+        Fail("FindSessions and ParseSession", text);
+    }
+}
+
+// The tail refresh resumes the scan after the sessions it keeps: it must
+// find the same sessions, and reject garbage right after the kept prefix
+void CheckResume(const std::string& text) {
+    std::vector<SessionParser::Range> ranges;
+    if (!SessionParser::FindSessions(text.data(), text.data() + text.size(), ranges) || ranges.empty()) {
+        return;
+    }
+    size_t offset = ranges[0].end;
+
+    std::vector<SessionParser::Range> tail;
+    if (!SessionParser::FindSessionsFrom(text.data(), text.data() + text.size(), offset, tail) ||
+        tail.size() != ranges.size() - 1 ||
+        !std::equal(tail.begin(), tail.end(), ranges.begin() + 1, [](const auto& a, const auto& b) {
+            return a.begin == b.begin && a.end == b.end;
+        })) {
+        Fail("FindSessionsFrom", text);
+    }
+
+    std::string corrupt = text;
+    corrupt.insert(offset, " xyz ");
+    tail.clear();
+    if (SessionParser::FindSessionsFrom(corrupt.data(), corrupt.data() + corrupt.size(), offset, tail)) {
+        Fail("FindSessionsFrom accepted a malformed separator", corrupt);
+    }
+}
+
+// The malformed separator must make every fast path give up
+const char* const MALFORMED_DOCUMENTS[] = {
+    "{\"sessions\":[{\"start_timestamp\":1} xyz {\"start_timestamp\":2}], \"foo\": nope}",
+    "{\"sessions\":[{\"start_timestamp\":1} xyz {\"start_timestamp\":2}]}",
+    "{\"sessions\":[{\"start_timestamp\":1},, {\"start_timestamp\":2}]}",
+    "{\"sessions\":[{\"start_timestamp\":1} {\"start_timestamp\":2}]}",
+    "{\"sessions\":[{\"start_timestamp\":1},]}",
+    "{\"sessions\":[, {\"start_timestamp\":1}]}",
+    "{\"sessions\":[{\"start_timestamp\":1}], \"foo\": nope}",
+    "{\"foo\": nope, \"sessions\":[{\"start_timestamp\":1}]}",
+    "{\"sessions\":[{\"start_timestamp\":1}]} trailing",
+};
+
+} // namespace
+
+int main() {
+    for (const char* text : MALFORMED_DOCUMENTS) {
+        std::vector<SessionParser::Range> ranges;
+        if (SessionParser::FindSessions(text, text + strlen(text), ranges)) {
+            Fail("FindSessions accepted a malformed document", text);
+        }
+        CheckDocument(text);
+    }
+
+    for (int iteration = 0; iteration < 2000; iteration++) {
+        std::string text = RandomDocument(iteration % 100 == 0 ? 300 : 6);
+        CheckDocument(text);
+        CheckResume(text);
+        for (int i = 0; i < 4; i++) {
+            CheckDocument(Mutate(text));
+        }
+    }
+
+    if (g_failures) {
+        printf("session_parser_test: %d failures\n", g_failures);
+        return 1;
+    }
+    printf("session_parser_test: ok\n");
+    return 0;
+}
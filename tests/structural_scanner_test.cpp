@@ -0,0 +1,75 @@
+// Checks every StructuralScanner level against a byte-at-a-time reference
+// on random text made mostly of quotes, backslashes and structurals.
+
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+#include "data/structural_scanner.h"
+
+using namespace bigbrother::viewer;
+
+namespace {
+
+std::vector<size_t> ReferenceScan(const std::string& text) {
+    std::vector<size_t> positions;
+    bool inString = false;
+    bool escaped = false;
+    for (size_t i = 0; i < text.size(); i++) {
+        char c = text[i];
+        bool isEscaped = escaped;
+        escaped = false;
+        if (c == '\\' && !isEscaped) {
+            // Like the scanner, a backslash escapes the next byte even outside a string
+            escaped = true;
+        } else if (c == '"' && !isEscaped) {
+            inString = !inString;
+            positions.push_back(i);
+        } else if (!inString && c != '\0' && strchr("{}[]:,", c)) {
+            positions.push_back(i);
+        }
+    }
+    return positions;
+}
+
+std::vector<size_t> Scan(const std::string& text, StructuralScanner::Level level) {
+    std::vector<size_t> positions;
+    StructuralScanner scanner(text.data(), text.data() + text.size(), level);
+    for (size_t offset = scanner.Next(); offset != StructuralScanner::NONE; offset = scanner.Next()) {
+        positions.push_back(offset);
+    }
+    return positions;
+}
+
+} // namespace
+
+int main() {
+    static const char ALPHABET[] = "\"\\{}[]:,ab \n";
+    const StructuralScanner::Level levels[] = {
+        StructuralScanner::Level::Scalar,
+        StructuralScanner::Level::SSE2,
+        StructuralScanner::Level::AVX2
+    };
+
+    std::mt19937 rng(1);
+    for (int iteration = 0; iteration < 20000; iteration++) {
+        // Lengths around the 64-byte block size matter most
+        size_t length = rng() % 300;
+        std::string text;
+        for (size_t i = 0; i < length; i++) {
+            text += ALPHABET[rng() % (sizeof(ALPHABET) - 1)];
+        }
+
+        std::vector<size_t> expected = ReferenceScan(text);
+        for (StructuralScanner::Level level : levels) {
+            if (Scan(text, level) != expected) {
+                printf("Level %d differs from the reference on:\n%s\n", (int)level, text.c_str());
+                return 1;
+            }
+        }
+    }
+
+    printf("structural_scanner_test: ok (best level %d)\n", (int)StructuralScanner::GetBestLevel());
+    return 0;
+}